@@ -7,17 +7,26 @@
 */
 
 #include "JerryTheRaceCarDriver.h"
+#include "frames.h"
+#include "latency.h"
 
 
 /**
     Driver constructor. Initializes the controller.
 */
 JerryTheRaceCarDriver::JerryTheRaceCarDriver() {
-    this->controller = Controller();
     this->restart_request_sent = false;
     this->step = 0;
 }
 
+/**
+    Driver destructor. Stops the deadline-aware controller, if any.
+*/
+JerryTheRaceCarDriver::~JerryTheRaceCarDriver() {
+    delete this->deadline;
+    delete this->predictor;
+}
+
 /**
     Defines rangefinders angles for the client.
 
@@ -40,12 +49,71 @@ void JerryTheRaceCarDriver::init(float* angles) {
     @param is_training Whether to train the controller.
 */
 void JerryTheRaceCarDriver::setModelLocation(std::string path, bool is_training) {
+    if (this->deadline != nullptr) this->deadline->wait();
     this->model_path = path;
     this->is_training = is_training;
     this->controller.setModelLocation(path);
     this->controller.train(is_training);
 }
 
+/**
+    Sets the time the controller is given at each simulation step.
+    When it takes longer, a cheap fallback action is sent instead
+    and the full controls are used at the next step.
+
+    @param microseconds Compute budget per simulation step,
+        or 0 to always wait for the controller.
+*/
+void JerryTheRaceCarDriver::setBudget(long microseconds) {
+    delete this->deadline;
+    this->deadline = nullptr;
+    if (microseconds > 0) {
+        this->deadline = new DeadlineController(this->controller, std::chrono::microseconds(microseconds));
+    }
+}
+
+/**
+    Puts a prediction stage in front of the controller: the car controls
+    apply about one simulation tick after the car state they are computed
+    from, hence the controller is given the car state extrapolated over
+    the measured client latency plus a number of ticks.
+
+    @param lead_ticks Number of simulation ticks to extrapolate over,
+        in addition to the client latency, or a negative value for
+        giving the decoded car state to the controller.
+*/
+void JerryTheRaceCarDriver::setPrediction(double lead_ticks) {
+    if (this->deadline != nullptr) this->deadline->wait();
+    delete this->predictor;
+    this->predictor = nullptr;
+    if (lead_ticks >= 0.0) {
+        this->predictor = new StatePredictor(lead_ticks);
+    }
+}
+
+/**
+    Car state the controller was given at the last simulation step:
+    the decoded one, or its extrapolation when predicting. This is the
+    state to be logged along with the car controls, for them to be
+    reproduced offline.
+
+    @return Input of the controller.
+*/
+const CarState& JerryTheRaceCarDriver::input() const {
+    return (this->predictor != nullptr) ? this->predictor->prediction() : this->cs;
+}
+
+/**
+    Whether the car controls of the last simulation step are the
+    fallback action sent when the compute budget was exceeded,
+    rather than the output of the controller for its input.
+
+    @return Whether the last action is a fallback.
+*/
+bool JerryTheRaceCarDriver::fellBack() const {
+    return (this->deadline != nullptr) && this->deadline->fellBack();
+}
+
 /**
     Evaluates the objective function, defined as the
     total distance raced from the beginning of the race,
@@ -74,6 +142,15 @@ void JerryTheRaceCarDriver::restart() {
     // Reset the counter of simulation steps
     this->step = 0;
 
+    // The dynamics of the last race tell nothing about the next one
+    if (this->predictor != nullptr) this->predictor->reset();
+
+    // The controller must be idle before being updated
+    if (this->deadline != nullptr) {
+        this->deadline->wait();
+        this->deadline->report(std::cout);
+    }
+
     // Evaluate the objective function
     double obj = this->objective();
 
@@ -92,23 +169,103 @@ void JerryTheRaceCarDriver::restart() {
 }
 
 /**
-    Drives the car.
+    Warms up the driver: drives synthetic sensor strings through the
+    same path as the race (decoding, prediction, deadline worker,
+    controller and encoding). The driver keeps state from one step to
+    the next (the car state, the step counter, the predictor history,
+    the deadline statistics and whether the gear module considers the
+    car stuck), so all of it is then discarded: the warm-up neither
+    counts as a race for the optimizer nor affects the first steps.
+
+    @param n_steps Number of synthetic simulation steps.
+*/
+void JerryTheRaceCarDriver::warmUp(size_t n_steps) {
+    std::vector<std::string> frames;
+    synthesizeFrames(n_steps, frames);
+    char action[1000];
+    for (const std::string &frame : frames) {
+        this->drive(frame, action, sizeof(action));
+    }
+
+    // The overruns of the warm-up are not reported, and without
+    // a distance raced, restarting does not evaluate the objective
+    if (this->deadline != nullptr) {
+        this->deadline->wait();
+        std::ostringstream discarded;
+        this->deadline->report(discarded);
+    }
+    this->cs = CarState();
+    this->restart();
+    this->controller.reset();
+    this->cc = CarControl();
+}
+
+/**
+    Drives the car. Same as the overload writing into a buffer (the
+    sensors are decoded into the current car state, so that sensors
+    missing from the message keep their previous values), with the
+    car controls returned as a string.
 
     @param sensors A string to be parsed, containing all the information
         about current state of the car.
     @return The car controls to be sent to the server.
 */
 std::string JerryTheRaceCarDriver::drive(std::string sensors) {
-    // Transfers car state to the controller and retrieves car controls
-    CarState cs(sensors);
-    CarControl cc = this->controller.control(cs);
+    char action[1000];
+    size_t length = this->drive(std::string_view(sensors), action, sizeof(action));
+    return std::string(action, length);
+}
+
+/**
+    Drives the car from a view over the message received from the
+    server, and writes the car controls directly into the buffer to
+    be sent to the server. The sensors are decoded in place into the
+    current car state: nothing is copied nor allocated. Sensors that
+    are missing from the message keep their previous values.
+
+    @param sensors View over the message to be parsed (text or binary
+        frame), containing all the information about current state of
+        the car. The car controls are written in the same format.
+    @param action Buffer where to write the car controls. It may
+        be the buffer the sensors message is read from.
+    @param size Capacity of the buffer.
+    @param rx_time Arrival time of the message on the monotonic clock,
+        in nanoseconds, or 0 for the time of the call. The car state
+        is extrapolated, and the latency measured, from that time.
+    @return Length of the action message (0 if it does not fit).
+*/
+size_t JerryTheRaceCarDriver::drive(std::string_view sensors, char* action, size_t size, int64_t rx_time) {
+    if (this->predictor != nullptr) this->frame_time = (rx_time != 0) ? rx_time : monotonicNanoseconds();
+
+    // Binary frames are answered with binary frames
+    bool binary = codec::isBinary(sensors.data(), sensors.size());
+    this->cs.parse(sensors.data(), sensors.size(), SENSORS);
+    CarControl cc = this->control(this->cs);
+    size_t length = binary ? cc.encodeBinary(action, size) : cc.encode(action, size);
+    if (this->predictor != nullptr) this->predictor->recordLatency(monotonicNanoseconds() - this->frame_time);
+    return length;
+}
+
+/**
+    Computes the car controls and handles race restart requests.
+
+    @param cs Current car state.
+    @return The car controls to be sent to the server.
+*/
+CarControl JerryTheRaceCarDriver::control(CarState &cs) {
+    // Transfers car state (or its extrapolation) to the controller and retrieves car controls
+    CarState &input = (this->predictor != nullptr) ? this->predictor->predict(cs, this->frame_time) : cs;
+    CarControl cc = (this->deadline != nullptr) ? this->deadline->control(input) : this->controller.control(input);
 
     // Stores current car state for future evaluation of
     // the objective function
-    this->cs = cs;
+    if (&cs != &this->cs) this->cs = cs;
 
     // No need to go further in the case of a race restart
-    if (this->restart_request_sent) return cc.toString();
+    if (this->restart_request_sent) {
+        this->cc = cc;
+        return cc;
+    }
 
     // Increment the number of simulation steps
     this->step++;
@@ -123,7 +280,8 @@ std::string JerryTheRaceCarDriver::drive(std::string sensors) {
             cc.meta = 1; // Race restart request
         }
     }
-    return cc.toString();
+    this->cc = cc;
+    return cc;
 }
 
 /**
@@ -134,6 +292,7 @@ std::string JerryTheRaceCarDriver::drive(std::string sensors) {
     @return Whether to stop racing.
 */
 bool JerryTheRaceCarDriver::readyToShutdown() {
+    if (this->deadline != nullptr) this->deadline->wait();
     if (this->is_training) {
         return this->controller.finishedLearning();
     } else{
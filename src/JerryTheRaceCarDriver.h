@@ -12,12 +12,15 @@
 #include <iostream>
 #include <cmath>
 #include <string>
+#include <string_view>
 
 #include "SimpleParser.h"
 
 #include "carstate.h"
 #include "carcontrol.h"
+#include "deadline.h"
 #include "driver.h"
+#include "predictor.h"
 
 
 class JerryTheRaceCarDriver {
@@ -30,13 +33,36 @@ public:
     // Track name
     char trackName[100];
 
-    // Current car state
-    CarState cs;
+    // Sensors needed for evaluating the objective function
+    // and deciding whether to restart the race
+    static constexpr unsigned int OBJECTIVE_SENSORS = sensorMask("curLapTime") | sensorMask("damage")
+        | sensorMask("distRaced") | sensorMask("fuel") | sensorMask("lastLapTime") | sensorMask("racePos");
+
+    // Sensors decoded at each simulation step
+    static constexpr unsigned int SENSORS = Controller::SENSORS | OBJECTIVE_SENSORS;
+
+    // Current car state, decoded in place at each simulation step
+    // (the fields outside SENSORS are never decoded and stay zero)
+    CarState cs = CarState();
+
+    // Car controls sent at the last simulation step
+    CarControl cc;
 
 private:
     // Controller for solving driving sub-tasks
     Controller controller;
 
+    // Controller running under a per-step compute budget
+    // (null if the controller is called synchronously)
+    DeadlineController* deadline = nullptr;
+
+    // Extrapolation of the car state over the client latency
+    // (null if the controller is given the decoded state)
+    StatePredictor* predictor = nullptr;
+
+    // Arrival time of the frame of the current simulation step
+    int64_t frame_time = 0;
+
     // Whether a race restart request has been sent to the server
     bool restart_request_sent = false;
 
@@ -49,11 +75,14 @@ private:
     // Current simulation step
     int step = 0;
 
+    // Computes the car controls for the current car state
+    CarControl control(CarState &cs);
+
 public:
 
     // Constructor and destructor
     JerryTheRaceCarDriver();
-    ~JerryTheRaceCarDriver() = default;
+    ~JerryTheRaceCarDriver();
 
     // Whether the driver is ready to stop racing
     // If the controller is training, this corresponds
@@ -61,7 +90,7 @@ public:
     bool readyToShutdown();
 
     // Initialize rangefinders angles for the client
-    void init(float *angles);
+    static void init(float *angles);
 
     // Restart race
     void restart();
@@ -69,12 +98,35 @@ public:
     // Set path to the file where to load/save parameters
     void setModelLocation(std::string path, bool is_training);
 
+    // Set the compute budget per simulation step (0 for none)
+    void setBudget(long microseconds);
+
+    // Feed the controller with car states extrapolated over the client
+    // latency plus a number of simulation ticks (negative for none)
+    void setPrediction(double lead_ticks);
+
+    // Drives synthetic states, then restarts, so that the first
+    // simulation steps do not pay for cold caches and lazily
+    // mapped memory
+    void warmUp(size_t n_steps);
+
+    // Car state the controller was given at the last simulation step
+    const CarState& input() const;
+
+    // Whether the controls of the last simulation step are the
+    // fallback of a budget overrun
+    bool fellBack() const;
+
     // Evaluate the objective function
     double objective();
 
     // Drive the car
     std::string drive(std::string sensors);
 
+    // Drive the car without copying the sensors message,
+    // writing the action message into a buffer
+    size_t drive(std::string_view sensors, char* action, size_t size, int64_t rx_time = 0);
+
 };
 
 #endif // JerryTheRaceCarDriver_H__
@@ -15,6 +15,9 @@
  ***************************************************************************/
 #include "SimpleParser.h"
 
+#include <charconv>
+#include <cstdint>
+
 bool
 SimpleParser::parse(string sensors, string tag, float &value)
 {
@@ -126,3 +129,160 @@ SimpleParser::stringify(string tag, float *value, int size)
 	STR << ")";
 	return STR.str();
 }
+
+/*
+ * Writes a single value into [first,last) without allocating, with
+ * the same output as "STR << value" (6 significant digits for floats).
+ * Returns the position right after the value, or NULL if it does
+ * not fit.
+ */
+char*
+SimpleParser::format(char *first, char *last, float value)
+{
+	std::to_chars_result res = std::to_chars(first, last, value, std::chars_format::general, 6);
+	if (res.ec != std::errc())
+		return NULL;
+	return res.ptr;
+}
+
+char*
+SimpleParser::format(char *first, char *last, int value)
+{
+	std::to_chars_result res = std::to_chars(first, last, value);
+	if (res.ec != std::errc())
+		return NULL;
+	return res.ptr;
+}
+
+bool
+SimpleParser::isSpace(char c)
+{
+	// Same set as the "C" locale used by istringstream
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+const char*
+SimpleParser::skipSpaces(const char *first, const char *last)
+{
+	while (first != last && isSpace(*first))
+		++first;
+	return first;
+}
+
+/*
+ * Exact powers of ten in single precision (5^10 < 2^24).
+ */
+static const float POW10[11] = {
+	1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+/*
+ * Reads a decimal number whose digits make an integer of at most
+ * 2^24 and whose decimal exponent is in [-10, 10], which covers the
+ * values the server prints (6 significant digits). Both the digits
+ * and the power of ten are then exact floats, so that a single
+ * multiplication or division rounds the value correctly, as strtof
+ * and from_chars do. Returns NULL for any other input, which is
+ * left to from_chars.
+ */
+static const char*
+scanShortDecimal(const char *first, const char *last, float &value)
+{
+	const char *p = first;
+	bool negative = (p != last && *p == '-');
+	if (negative)
+		++p;
+
+	uint32_t mantissa = 0;
+	bool has_digits = false;
+	int exponent = 0;
+	for (; p != last && (unsigned) (*p - '0') < 10; ++p)
+	{
+		if (mantissa > (1u << 24))
+			return NULL;
+		mantissa = mantissa * 10 + (*p - '0');
+		has_digits = true;
+	}
+	if (p != last && *p == '.')
+	{
+		for (++p; p != last && (unsigned) (*p - '0') < 10; ++p, --exponent)
+		{
+			if (mantissa > (1u << 24))
+				return NULL;
+			mantissa = mantissa * 10 + (*p - '0');
+			has_digits = true;
+		}
+	}
+	if (!has_digits || mantissa > (1u << 24))
+		return NULL;
+
+	// The exponent part is only consumed if it has digits
+	if (p != last && (*p == 'e' || *p == 'E'))
+	{
+		const char *q = p + 1;
+		bool negative_exponent = (q != last && *q == '-');
+		if (q != last && (*q == '-' || *q == '+'))
+			++q;
+		if (q != last && (unsigned) (*q - '0') < 10)
+		{
+			int e = 0;
+			for (; q != last && (unsigned) (*q - '0') < 10 && e < 100; ++q)
+				e = e * 10 + (*q - '0');
+			if (q != last && (unsigned) (*q - '0') < 10)
+				return NULL;
+			exponent += negative_exponent ? -e : e;
+			p = q;
+		}
+	}
+	if (exponent < -10 || exponent > 10)
+		return NULL;
+
+	float x = (float) mantissa;
+	x = (exponent < 0) ? x / POW10[-exponent] : x * POW10[exponent];
+	value = negative ? -x : x;
+	return p;
+}
+
+/*
+ * Reads a single value from [first,last) without allocating.
+ * Leading spaces are skipped like "IN >> value" does: value is
+ * left unchanged if nothing is left to read and set to 0 if what
+ * follows is not a number. Returns the position right after the
+ * value, or NULL if no value could be read.
+ */
+const char*
+SimpleParser::scan(const char *first, const char *last, float &value)
+{
+	first = skipSpaces(first, last);
+	if (first == last)
+		return NULL;
+	if (*first == '+')
+		++first;
+	const char *end = scanShortDecimal(first, last, value);
+	if (end != NULL)
+		return end;
+	std::from_chars_result res = std::from_chars(first, last, value);
+	if (res.ec != std::errc())
+	{
+		value = 0;
+		return NULL;
+	}
+	return res.ptr;
+}
+
+const char*
+SimpleParser::scan(const char *first, const char *last, int &value)
+{
+	first = skipSpaces(first, last);
+	if (first == last)
+		return NULL;
+	if (*first == '+')
+		++first;
+	std::from_chars_result res = std::from_chars(first, last, value);
+	if (res.ec != std::errc())
+	{
+		value = 0;
+		return NULL;
+	}
+	return res.ptr;
+}
@@ -38,6 +38,18 @@ public:
 
         static string  stringify(string tag, float *value, int size);
 
+        static const char*  scan(const char *first, const char *last, float &value);
+
+        static const char*  scan(const char *first, const char *last, int &value);
+
+        static char*  format(char *first, char *last, float value);
+
+        static char*  format(char *first, char *last, int value);
+
+        static const char*  skipSpaces(const char *first, const char *last);
+
+        static bool  isSpace(char c);
+
 };
 
 #endif /*SIMPLEPARSER_H_*/
@@ -9,6 +9,13 @@
 #include "accelbrake.h"
 
 
+/**
+    Constructs the module. The only parameter is
+    the ABS filtering threshold.
+*/
+template <typename T>
+AccelBrakeModule<T>::AccelBrakeModule() {}
+
 /**
     Process car state and outputs a control value for the
     brake/acceleration. The value ranges from 0 to 1,
@@ -17,43 +24,39 @@
     performed.
 
     @param cs The current car state.
+    @param features Features of the current car state.
     @param target_speed The desired speed, as outputed by the
         target speed module.
     @return The acceleration/brake control value.
 */
-double AccelBrakeModule::control(CarState &cs, double target_speed) {
-    double accelbrake;
+template <typename T>
+T AccelBrakeModule<T>::control(CarState &cs, const CarFeatures<T> &features, T target_speed) {
+    T accelbrake;
     if (cs.gear == -1) {
         accelbrake = 1.0;
     } else {
         // Speed control value: close to 2 when the deviation from
         // the desired speed is very large and 0 in the opposite case
-        accelbrake = 2.0 / (1.0 + std::exp(cs.getSpeed() - target_speed));
+        // (libm even with ACTIVATIONS=approx: for a single value, the
+        // approximation is no faster, see act/exp-*-1 in the benchmarks)
+        accelbrake = T(2) / (T(1) + std::exp(features.speed - target_speed));
 
         // ABS filtering for preventing the car from slipping
-        if (cs.getSpeed() - cs.getWheelsSpeed() > this->threshold) {
-            accelbrake -= (cs.getSpeed() - cs.getWheelsSpeed() - this->threshold) / 5.0;
+        T threshold = this->parameters[THRESHOLD];
+        if (features.slip > threshold) {
+            accelbrake -= (features.slip - threshold) / T(5);
         }
-        accelbrake /= 2.0; // Normalize the output value
+        accelbrake /= T(2); // Normalize the output value
     }
     return accelbrake;
 }
 
-/**
-    Number of parameters in the module.
-    The only parameter is the ABS filtering threshold.
-
-    @return The number of parameters.
-*/
-size_t AccelBrakeModule::getNumberOfParameters() {
-    return 1;
-}
-
 /**
     @return Lower bounds on the module parameters.
 */
-Eigen::VectorXd AccelBrakeModule::getLowerBounds() {
-    Eigen::VectorXd lbs = Eigen::VectorXd::Zero(1);
+template <typename T>
+typename AccelBrakeModule<T>::tVector AccelBrakeModule<T>::getLowerBounds() {
+    tVector lbs = tVector::Zero();
     lbs[0] = this->threshold_lb;
     return lbs;
 }
@@ -61,28 +64,13 @@ Eigen::VectorXd AccelBrakeModule::getLowerBounds() {
 /**
     @return Upper bounds on the module parameters.
 */
-Eigen::VectorXd AccelBrakeModule::getUpperBounds() {
-    Eigen::VectorXd ubs = Eigen::VectorXd::Zero(1);
+template <typename T>
+typename AccelBrakeModule<T>::tVector AccelBrakeModule<T>::getUpperBounds() {
+    tVector ubs = tVector::Zero();
     ubs[0] = this->threshold_ub;
     return ubs;
 }
 
-/**
-    Gets current values of module parameters.
-
-    @return Current values of module parameters.
-*/
-Eigen::VectorXd AccelBrakeModule::getParameters() {
-    Eigen::VectorXd parameters = Eigen::VectorXd::Zero(1);
-    parameters[0] = this->threshold;
-    return parameters;
-}
 
-/**
-    Sets current values of module parameters.
-
-    @param Current values of module parameters.
-*/
-void AccelBrakeModule::setParameters(Eigen::VectorXd parameters) {
-    this->threshold = parameters[0];
-}
+template class AccelBrakeModule<float>;
+template class AccelBrakeModule<double>;
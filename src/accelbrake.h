@@ -12,35 +12,42 @@
 #include <Eigen/Core>
 
 #include "carstate.h"
+#include "carfeatures.h"
 #include "module.h"
 
 
-class AccelBrakeModule : Module {
+template <typename T>
+class AccelBrakeModule : public Module<AccelBrakeModule<T>, T, 1> {
 private:
 
     // Lower bound on the ABS filtering threshold
-    static constexpr double threshold_lb = 1.0;
+    static constexpr T threshold_lb = 1.0;
 
     // Upper bound on the ABS filtering threshold
-    static constexpr double threshold_ub = 2.0;
+    static constexpr T threshold_ub = 2.0;
 
-    // ABS filtering threshold
-    double threshold;
+    // The only parameter is the ABS filtering threshold
+    static constexpr int THRESHOLD = 0;
 public:
+    // Base class and parameter vectors
+    typedef Module<AccelBrakeModule<T>, T, 1> tModule;
+    typedef typename tModule::tVector tVector;
+    static_assert(THRESHOLD + 1 == tModule::N_PARAMETERS, "Parameter layout does not match the module size");
+
+    // Sensors read by the module
+    static constexpr unsigned int SENSORS = sensorMask("gear") | sensorMask("speedX")
+        | sensorMask("speedY") | sensorMask("speedZ") | sensorMask("wheelSpinVel");
 
     // Constructor
-    AccelBrakeModule() = default;
+    AccelBrakeModule();
 
     // Outputs an acceleration/brake control parameter
     // based on sensory data
-    double control(CarState &cs, double target_speed);
-
-    // abstract methods
-    virtual size_t getNumberOfParameters();
-    virtual Eigen::VectorXd getLowerBounds();
-    virtual Eigen::VectorXd getUpperBounds();
-    virtual Eigen::VectorXd getParameters();
-    virtual void setParameters(Eigen::VectorXd parameters);
+    T control(CarState &cs, const CarFeatures<T> &features, T target_speed);
+
+    // Bounds on the parameters
+    tVector getLowerBounds();
+    tVector getUpperBounds();
 };
 
 
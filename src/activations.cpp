@@ -0,0 +1,412 @@
+/**
+    activations.cpp
+    Vectorized approximations of the activation functions
+
+    The exponential is computed as 2^n * exp(r), with n the nearest
+    integer to x / ln(2) and |r| <= ln(2) / 2, and exp(r) given by its
+    minimax polynomial of degree 5 (relative error below 7.5e-8, which
+    is far below the noise of the sensors the networks are fed with).
+    The hyperbolic tangent and the sigmoid are derived from it. The
+    kernels exist in double and single precision, and process 4 doubles
+    or 8 floats at a time with AVX2, 2 doubles or 4 floats at a time
+    with SSE2, and one value at a time otherwise, depending on the
+    instruction set the file is compiled for (see SIMD in the Makefile).
+    The rounding to the nearest integer assumes that arithmetic is done
+    in the precision of the values, i.e. no x87 excess precision.
+
+    @author Antoine Passemiers
+    @version 1.0 17/08/2019
+*/
+
+#include "activations.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+// Constants of the kernels, for each precision
+template <typename T>
+struct Constants;
+
+template <>
+struct Constants<double> {
+    // Range reduction: x = n * ln(2) + r, with ln(2) split in two parts
+    // so that n * LN2_HI is exact
+    static constexpr double LOG2E = 1.4426950408889634;
+    static constexpr double LN2_HI = 0.693145751953125;
+    static constexpr double LN2_LO = 1.42860682030941723212e-6;
+
+    // Adding 1.5 * 2^52 rounds to the nearest integer, which then sits
+    // in the low bits of the representation
+    static constexpr double ROUNDING = 6755399441055744.0;
+
+    // Inputs of the exponential are clamped so that 2^n stays normal
+    static constexpr double EXP_MIN = -708.0;
+    static constexpr double EXP_MAX = 709.0;
+
+    // Beyond this value, tanh is 1 in double precision
+    static constexpr double TANH_MAX = 20.0;
+};
+
+template <>
+struct Constants<float> {
+    static constexpr float LOG2E = 1.44269504f;
+    static constexpr float LN2_HI = 0.693359375f;
+    static constexpr float LN2_LO = -2.12194440e-4f;
+
+    // 1.5 * 2^23
+    static constexpr float ROUNDING = 12582912.0f;
+
+    static constexpr float EXP_MIN = -87.0f;
+    static constexpr float EXP_MAX = 88.0f;
+
+    // Beyond this value, tanh is 1 in single precision
+    static constexpr float TANH_MAX = 9.0f;
+};
+
+// Coefficients of the polynomial of degree 5 minimizing the largest
+// relative error to exp(r) over [-ln(2) / 2, ln(2) / 2] (Remez algorithm)
+static constexpr double MINIMAX[6] = {
+    1.0000000716546822, 0.9999996919915167, 0.49998894851221964,
+    0.16667574728755044, 0.04191538199169587, 0.008297655080363472
+};
+
+
+// Operations on packs of values, for each instruction set
+template <typename T>
+struct Pack;
+
+#if defined(__AVX2__)
+
+template <>
+struct Pack<double> {
+    typedef __m256d type;
+    static constexpr size_t SIZE = 4;
+    static type set(double x) { return _mm256_set1_pd(x); }
+    static type load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, type x) { _mm256_storeu_pd(p, x); }
+    static type add(type a, type b) { return _mm256_add_pd(a, b); }
+    static type sub(type a, type b) { return _mm256_sub_pd(a, b); }
+    static type mul(type a, type b) { return _mm256_mul_pd(a, b); }
+    static type div(type a, type b) { return _mm256_div_pd(a, b); }
+    static type min(type a, type b) { return _mm256_min_pd(a, b); }
+    static type max(type a, type b) { return _mm256_max_pd(a, b); }
+#ifdef __FMA__
+    static type madd(type a, type b, type c) { return _mm256_fmadd_pd(a, b, c); }
+#else
+    static type madd(type a, type b, type c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#endif
+    static type sign(type x) { return _mm256_and_pd(x, _mm256_set1_pd(-0.0)); }
+    static type abs(type x) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), x); }
+    static type copySign(type x, type s) { return _mm256_or_pd(x, s); }
+    static type pow2(type rounded) {
+        __m256i n = _mm256_add_epi64(_mm256_castpd_si256(rounded), _mm256_set1_epi64x(1023));
+        return _mm256_castsi256_pd(_mm256_slli_epi64(n, 52));
+    }
+};
+
+template <>
+struct Pack<float> {
+    typedef __m256 type;
+    static constexpr size_t SIZE = 8;
+    static type set(float x) { return _mm256_set1_ps(x); }
+    static type load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, type x) { _mm256_storeu_ps(p, x); }
+    static type add(type a, type b) { return _mm256_add_ps(a, b); }
+    static type sub(type a, type b) { return _mm256_sub_ps(a, b); }
+    static type mul(type a, type b) { return _mm256_mul_ps(a, b); }
+    static type div(type a, type b) { return _mm256_div_ps(a, b); }
+    static type min(type a, type b) { return _mm256_min_ps(a, b); }
+    static type max(type a, type b) { return _mm256_max_ps(a, b); }
+#ifdef __FMA__
+    static type madd(type a, type b, type c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+    static type madd(type a, type b, type c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+    static type sign(type x) { return _mm256_and_ps(x, _mm256_set1_ps(-0.0f)); }
+    static type abs(type x) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x); }
+    static type copySign(type x, type s) { return _mm256_or_ps(x, s); }
+    static type pow2(type rounded) {
+        __m256i n = _mm256_add_epi32(_mm256_castps_si256(rounded), _mm256_set1_epi32(127));
+        return _mm256_castsi256_ps(_mm256_slli_epi32(n, 23));
+    }
+};
+static const char* INSTRUCTION_SET = "AVX2";
+
+#elif defined(__SSE2__)
+
+template <>
+struct Pack<double> {
+    typedef __m128d type;
+    static constexpr size_t SIZE = 2;
+    static type set(double x) { return _mm_set1_pd(x); }
+    static type load(const double* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, type x) { _mm_storeu_pd(p, x); }
+    static type add(type a, type b) { return _mm_add_pd(a, b); }
+    static type sub(type a, type b) { return _mm_sub_pd(a, b); }
+    static type mul(type a, type b) { return _mm_mul_pd(a, b); }
+    static type div(type a, type b) { return _mm_div_pd(a, b); }
+    static type min(type a, type b) { return _mm_min_pd(a, b); }
+    static type max(type a, type b) { return _mm_max_pd(a, b); }
+    static type madd(type a, type b, type c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+    static type sign(type x) { return _mm_and_pd(x, _mm_set1_pd(-0.0)); }
+    static type abs(type x) { return _mm_andnot_pd(_mm_set1_pd(-0.0), x); }
+    static type copySign(type x, type s) { return _mm_or_pd(x, s); }
+    static type pow2(type rounded) {
+        __m128i n = _mm_add_epi64(_mm_castpd_si128(rounded), _mm_set1_epi64x(1023));
+        return _mm_castsi128_pd(_mm_slli_epi64(n, 52));
+    }
+};
+
+template <>
+struct Pack<float> {
+    typedef __m128 type;
+    static constexpr size_t SIZE = 4;
+    static type set(float x) { return _mm_set1_ps(x); }
+    static type load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, type x) { _mm_storeu_ps(p, x); }
+    static type add(type a, type b) { return _mm_add_ps(a, b); }
+    static type sub(type a, type b) { return _mm_sub_ps(a, b); }
+    static type mul(type a, type b) { return _mm_mul_ps(a, b); }
+    static type div(type a, type b) { return _mm_div_ps(a, b); }
+    static type min(type a, type b) { return _mm_min_ps(a, b); }
+    static type max(type a, type b) { return _mm_max_ps(a, b); }
+    static type madd(type a, type b, type c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static type sign(type x) { return _mm_and_ps(x, _mm_set1_ps(-0.0f)); }
+    static type abs(type x) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), x); }
+    static type copySign(type x, type s) { return _mm_or_ps(x, s); }
+    static type pow2(type rounded) {
+        __m128i n = _mm_add_epi32(_mm_castps_si128(rounded), _mm_set1_epi32(127));
+        return _mm_castsi128_ps(_mm_slli_epi32(n, 23));
+    }
+};
+static const char* INSTRUCTION_SET = "SSE2";
+
+#else
+
+template <typename T>
+struct Pack {
+    typedef T type;
+    // Unsigned integer of the size of T, for the exponent manipulation
+    typedef typename std::conditional<sizeof(T) == 8, uint64_t, uint32_t>::type tBits;
+    static constexpr size_t SIZE = 1;
+    static type set(T x) { return x; }
+    static type load(const T* p) { return *p; }
+    static void store(T* p, type x) { *p = x; }
+    static type add(type a, type b) { return a + b; }
+    static type sub(type a, type b) { return a - b; }
+    static type mul(type a, type b) { return a * b; }
+    static type div(type a, type b) { return a / b; }
+    static type min(type a, type b) { return std::min(a, b); }
+    static type max(type a, type b) { return std::max(a, b); }
+    static type madd(type a, type b, type c) { return a * b + c; }
+    static type sign(type x) { return std::copysign(T(0), x); }
+    static type abs(type x) { return std::fabs(x); }
+    static type copySign(type x, type s) { return std::copysign(x, s); }
+    static type pow2(type rounded) {
+        tBits n;
+        std::memcpy(&n, &rounded, sizeof(n));
+        n = (n + std::numeric_limits<T>::max_exponent - 1) << (std::numeric_limits<T>::digits - 1);
+        T p;
+        std::memcpy(&p, &n, sizeof(p));
+        return p;
+    }
+};
+static const char* INSTRUCTION_SET = "scalar";
+
+#endif
+
+
+/**
+    Exponential of a pack of values.
+
+    @param x Values, clamped to [EXP_MIN, EXP_MAX].
+    @return Exponentials.
+*/
+template <typename T>
+static inline typename Pack<T>::type packExp(typename Pack<T>::type x) {
+    typedef Pack<T> P;
+    typedef Constants<T> C;
+    x = P::min(P::max(x, P::set(C::EXP_MIN)), P::set(C::EXP_MAX));
+    typename P::type rounded = P::madd(x, P::set(C::LOG2E), P::set(C::ROUNDING));
+    typename P::type n = P::sub(rounded, P::set(C::ROUNDING));
+    typename P::type r = P::sub(x, P::mul(n, P::set(C::LN2_HI)));
+    r = P::sub(r, P::mul(n, P::set(C::LN2_LO)));
+
+    // Estrin's scheme: the polynomial is evaluated as a tree of depth 3
+    // rather than a chain of 5 multiply-adds, since small layers are
+    // bound by the latency of the chain
+    typename P::type r2 = P::mul(r, r);
+    typename P::type r4 = P::mul(r2, r2);
+    typename P::type q0 = P::madd(P::set(T(MINIMAX[1])), r, P::set(T(MINIMAX[0])));
+    typename P::type q1 = P::madd(P::set(T(MINIMAX[3])), r, P::set(T(MINIMAX[2])));
+    typename P::type q2 = P::madd(P::set(T(MINIMAX[5])), r, P::set(T(MINIMAX[4])));
+    typename P::type p = P::madd(q2, r4, P::madd(q1, r2, q0));
+    return P::mul(p, P::pow2(rounded));
+}
+
+/**
+    Hyperbolic tangent of a pack of values: 1 - 2 / (exp(2|x|) + 1),
+    with the sign of x.
+
+    @param x Values.
+    @return Hyperbolic tangents.
+*/
+template <typename T>
+static inline typename Pack<T>::type packTanh(typename Pack<T>::type x) {
+    typedef Pack<T> P;
+    typename P::type a = P::min(P::abs(x), P::set(Constants<T>::TANH_MAX));
+    typename P::type e = packExp<T>(P::add(a, a));
+    typename P::type t = P::sub(P::set(T(1)), P::div(P::set(T(2)), P::add(e, P::set(T(1)))));
+    return P::copySign(t, P::sign(x));
+}
+
+/**
+    Sigmoid of a pack of values: 1 / (1 + exp(-x)).
+
+    @param x Values.
+    @return Sigmoids.
+*/
+template <typename T>
+static inline typename Pack<T>::type packSigmoid(typename Pack<T>::type x) {
+    typedef Pack<T> P;
+    typename P::type e = packExp<T>(P::sub(P::set(T(0)), x));
+    return P::div(P::set(T(1)), P::add(P::set(T(1)), e));
+}
+
+/**
+    Applies a kernel in place to an array, two packs at a time so that
+    their computations overlap. The last values are processed as a pack
+    ending at the end of the array, loaded before anything is stored
+    so that the values it shares with the previous pack are computed
+    from the inputs, and rewritten with the same results. Arrays
+    smaller than a pack are processed as a padded pack.
+
+    @param X Array of values.
+    @param n Number of values.
+    @param kernel Function of a pack (a lambda, so that it is inlined).
+*/
+template <typename T, typename Kernel>
+static inline void applyPacked(T* X, size_t n, Kernel kernel) {
+    typedef Pack<T> P;
+    if (n < P::SIZE) {
+        T padded[P::SIZE] = { T(0) };
+        std::copy(X, X + n, padded);
+        P::store(padded, kernel(P::load(padded)));
+        std::copy(padded, padded + n, X);
+        return;
+    }
+    typename P::type last = P::load(X + n - P::SIZE);
+    size_t i = 0;
+    for (; i + 2 * P::SIZE <= n; i += 2 * P::SIZE) {
+        typename P::type a = kernel(P::load(X + i));
+        typename P::type b = kernel(P::load(X + i + P::SIZE));
+        P::store(X + i, a);
+        P::store(X + i + P::SIZE, b);
+    }
+    if (i + P::SIZE < n) {
+        typename P::type a = kernel(P::load(X + i));
+        typename P::type b = kernel(last);
+        P::store(X + i, a);
+        P::store(X + n - P::SIZE, b);
+    } else if (i < n) {
+        P::store(X + n - P::SIZE, kernel(last));
+    }
+}
+
+/**
+    @return Name of the instruction set the kernels use.
+*/
+const char* approxInstructionSet() {
+    return INSTRUCTION_SET;
+}
+
+/**
+    In place exponential of an array, with a relative error below
+    APPROX_EXP_MAX_ERROR for inputs in [-708, 709]. Inputs out of
+    this range are clamped to it.
+
+    @param X Array of values.
+    @param n Number of values.
+*/
+void approxExp(double* X, size_t n) {
+    applyPacked(X, n, [](Pack<double>::type x) { return packExp<double>(x); });
+}
+
+/**
+    In place exponential of an array of floats, with a relative error
+    below APPROX_EXP_MAX_ERROR_FLOAT for inputs in [-87, 88]. Inputs
+    out of this range are clamped to it.
+
+    @param X Array of values.
+    @param n Number of values.
+*/
+void approxExp(float* X, size_t n) {
+    applyPacked(X, n, [](Pack<float>::type x) { return packExp<float>(x); });
+}
+
+/**
+    Exponential of a single value (see approxExp for arrays).
+
+    @param x Value.
+    @return Exponential of the value.
+*/
+double approxExp(double x) {
+    double y[Pack<double>::SIZE];
+    Pack<double>::store(y, packExp<double>(Pack<double>::set(x)));
+    return y[0];
+}
+
+/**
+    In place hyperbolic tangent of an array, with an absolute
+    error below APPROX_TANH_MAX_ERROR.
+
+    @param X Array of values.
+    @param n Number of values.
+*/
+void approxTanh(double* X, size_t n) {
+    applyPacked(X, n, [](Pack<double>::type x) { return packTanh<double>(x); });
+}
+
+/**
+    In place hyperbolic tangent of an array of floats, with an
+    absolute error below APPROX_TANH_MAX_ERROR_FLOAT.
+
+    @param X Array of values.
+    @param n Number of values.
+*/
+void approxTanh(float* X, size_t n) {
+    applyPacked(X, n, [](Pack<float>::type x) { return packTanh<float>(x); });
+}
+
+/**
+    In place sigmoid of an array, with an absolute error
+    below APPROX_SIGMOID_MAX_ERROR.
+
+    @param X Array of values.
+    @param n Number of values.
+*/
+void approxSigmoid(double* X, size_t n) {
+    applyPacked(X, n, [](Pack<double>::type x) { return packSigmoid<double>(x); });
+}
+
+/**
+    In place sigmoid of an array of floats, with an absolute error
+    below APPROX_SIGMOID_MAX_ERROR_FLOAT.
+
+    @param X Array of values.
+    @param n Number of values.
+*/
+void approxSigmoid(float* X, size_t n) {
+    applyPacked(X, n, [](Pack<float>::type x) { return packSigmoid<float>(x); });
+}
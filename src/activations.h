@@ -0,0 +1,47 @@
+/**
+    activations.h
+    Vectorized approximations of the activation functions
+
+    @author Antoine Passemiers
+    @version 1.0 17/08/2019
+*/
+
+#ifndef ACTIVATIONS_H__
+#define ACTIVATIONS_H__
+
+#include <cstddef>
+
+
+// Bounds on the error of the approximations, checked by the benchmarks:
+// relative error of exp, absolute error of tanh and sigmoid
+#define APPROX_EXP_MAX_ERROR 1e-7
+#define APPROX_TANH_MAX_ERROR 1e-7
+#define APPROX_SIGMOID_MAX_ERROR 1e-7
+
+// Same bounds in single precision, where the rounding of the
+// values (6e-8 relative) adds to the error of the polynomial
+#define APPROX_EXP_MAX_ERROR_FLOAT 1e-6
+#define APPROX_TANH_MAX_ERROR_FLOAT 1e-6
+#define APPROX_SIGMOID_MAX_ERROR_FLOAT 1e-6
+
+
+// Instruction set the approximations were compiled for
+const char* approxInstructionSet();
+
+// In place exponential of an array
+void approxExp(double* X, size_t n);
+void approxExp(float* X, size_t n);
+
+// Exponential of a single value
+double approxExp(double x);
+
+// In place hyperbolic tangent of an array
+void approxTanh(double* X, size_t n);
+void approxTanh(float* X, size_t n);
+
+// In place sigmoid of an array
+void approxSigmoid(double* X, size_t n);
+void approxSigmoid(float* X, size_t n);
+
+
+#endif // ACTIVATIONS_H__
@@ -0,0 +1,625 @@
+/**
+    bench.cpp
+    Benchmarks of the sensor/action codecs and of the driver
+
+    @author Antoine Passemiers
+    @version 1.0 07/08/2019
+*/
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "JerryTheRaceCarDriver.h"
+#include "activations.h"
+#include "fixedmlp.h"
+#include "frames.h"
+#include "mlp.h"
+
+
+using namespace std;
+
+
+/*** allocation counting ***/
+// Counted at the malloc level rather than in operator new, so that the
+// allocations Eigen makes for dynamic matrices (which go straight to
+// malloc) are counted too. The glibc implementations are reached through
+// their __libc_* aliases.
+extern "C"
+{
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+}
+
+static unsigned long nAllocations = 0;
+
+extern "C" void* malloc(size_t size)
+{
+    nAllocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size)
+{
+    nAllocations++;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+    nAllocations++;
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" int posix_memalign(void** ptr, size_t alignment, size_t size)
+{
+    if ((alignment % sizeof(void*) != 0) || ((alignment & (alignment - 1)) != 0))
+        return EINVAL;
+    nAllocations++;
+    *ptr = __libc_memalign(alignment, size);
+    return (*ptr == NULL) ? ENOMEM : 0;
+}
+
+extern "C" void* aligned_alloc(size_t alignment, size_t size)
+{
+    nAllocations++;
+    return __libc_memalign(alignment, size);
+}
+
+
+// Result of a benchmark
+typedef struct
+{
+    string name;
+    double nsPerFrame;
+    double allocsPerFrame;
+    double framesPerSecond;
+    double megabytesPerSecond;
+} tResult;
+
+// Prevents the compiler from optimizing the benchmarked code away
+static volatile double sink;
+
+
+/**
+    Runs a benchmark over the whole corpus. The measurement is repeated
+    and the fastest repetition is kept, each repetition going over the
+    corpus as many times as needed to last at least minSeconds.
+
+    @param name Name of the benchmark.
+    @param frames Corpus of sensor strings.
+    @param minSeconds Minimum duration of a repetition.
+    @param body Code to be benchmarked, called once per frame.
+    @return Measurements.
+*/
+template <typename Body>
+tResult run(const string &name, const vector<string> &frames, double minSeconds, Body body)
+{
+    const int nRepetitions = 5;
+    size_t nBytes = 0;
+    for (size_t i = 0; i < frames.size(); i++)
+        nBytes += frames[i].size();
+
+    // Warm-up pass
+    for (size_t i = 0; i < frames.size(); i++)
+        body(frames[i]);
+
+    tResult result;
+    result.name = name;
+    result.nsPerFrame = -1.0;
+    for (int r = 0; r < nRepetitions; r++)
+    {
+        unsigned long nFrames = 0;
+        unsigned long nPasses = 0;
+        unsigned long allocations = nAllocations;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        double elapsed = 0.0;
+        do
+        {
+            for (size_t i = 0; i < frames.size(); i++)
+                body(frames[i]);
+            nFrames += frames.size();
+            nPasses++;
+            elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        } while (elapsed < minSeconds);
+        allocations = nAllocations - allocations;
+
+        double nsPerFrame = elapsed * 1e9 / nFrames;
+        if ((result.nsPerFrame < 0.0) || (nsPerFrame < result.nsPerFrame))
+        {
+            result.nsPerFrame = nsPerFrame;
+            result.allocsPerFrame = (double) allocations / nFrames;
+            result.framesPerSecond = nFrames / elapsed;
+            result.megabytesPerSecond = (nBytes * nPasses) / elapsed / 1e6;
+        }
+    }
+    return result;
+}
+
+/**
+    Decodes a sensor string tag by tag with the original SimpleParser.
+
+    @param s Sensor string.
+    @param cs Car state to be filled.
+*/
+void decodeWithSimpleParser(const string &s, CarState &cs)
+{
+    SimpleParser::parse(s, "angle", cs.angle);
+    SimpleParser::parse(s, "curLapTime", cs.curLapTime);
+    SimpleParser::parse(s, "damage", cs.damage);
+    SimpleParser::parse(s, "distFromStart", cs.distFromStart);
+    SimpleParser::parse(s, "distRaced", cs.distRaced);
+    SimpleParser::parse(s, "focus", cs.focus, FOCUS_SENSORS_NUM);
+    SimpleParser::parse(s, "fuel", cs.fuel);
+    SimpleParser::parse(s, "gear", cs.gear);
+    SimpleParser::parse(s, "lastLapTime", cs.lastLapTime);
+    SimpleParser::parse(s, "opponents", cs.opponents, OPPONENTS_SENSORS_NUM);
+    SimpleParser::parse(s, "racePos", cs.racePos);
+    SimpleParser::parse(s, "rpm", cs.rpm);
+    SimpleParser::parse(s, "speedX", cs.speedX);
+    SimpleParser::parse(s, "speedY", cs.speedY);
+    SimpleParser::parse(s, "speedZ", cs.speedZ);
+    SimpleParser::parse(s, "track", cs.track, TRACK_SENSORS_NUM);
+    SimpleParser::parse(s, "trackPos", cs.trackPos);
+    SimpleParser::parse(s, "wheelSpinVel", cs.wheelSpinVel, 4);
+    SimpleParser::parse(s, "z", cs.z);
+}
+
+/**
+    Decodes every frame of the corpus with SimpleParser and with
+    CarState::parse, and compares the values of every field bit
+    for bit, so that the single pass decoder and its number parser
+    are checked against the original one on the whole corpus.
+
+    @param frames Corpus of sensor strings.
+    @return Number of frames decoded differently.
+*/
+int checkDecoding(const vector<string> &frames)
+{
+    int nMismatches = 0;
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        CarState expected = CarState();
+        CarState actual = CarState();
+        decodeWithSimpleParser(frames[i], expected);
+        actual.parse(frames[i].data(), frames[i].size());
+
+        const char* e = reinterpret_cast<const char*>(&expected);
+        const char* a = reinterpret_cast<const char*>(&actual);
+        for (const Field &field : CAR_STATE_FIELDS)
+        {
+            if (memcmp(e + field.offset, a + field.offset, 4 * field.size) != 0)
+            {
+                if (nMismatches < 10)
+                    fprintf(stderr, "frame %zu: %s decoded differently by SimpleParser and CarState::parse\n",
+                            i, field.tag);
+                nMismatches++;
+                break;
+            }
+        }
+    }
+    if (nMismatches > 0)
+        cerr << nMismatches << " of " << frames.size() << " frames decoded differently" << endl;
+    else
+        cout << "Decoding: all " << frames.size() << " frames identical with SimpleParser and CarState::parse" << endl;
+    return nMismatches;
+}
+
+/**
+    Measures the largest errors of the approximated activation functions
+    in one precision against libm, over a sweep of their input range.
+
+    @param expRange Bound on the inputs of exp, whose exponentials
+        are normal numbers in this precision.
+    @param expError Relative error of exp.
+    @param tanhError Absolute error of tanh.
+    @param sigmoidError Absolute error of sigmoid.
+*/
+template <typename T>
+void activationErrors(double expRange, double &expError, double &tanhError, double &sigmoidError)
+{
+    vector<T> x, y;
+    expError = tanhError = sigmoidError = 0.0;
+
+    // Relative error of exp, wherever it is a normal number
+    for (double v = -expRange; v <= expRange; v += 0.0137)
+        x.push_back(v);
+    y = x;
+    approxExp(y.data(), y.size());
+    for (size_t i = 0; i < x.size(); i++)
+        expError = max(expError, fabs(y[i] - exp((double) x[i])) / exp((double) x[i]));
+
+    // Absolute errors of tanh and sigmoid, over and beyond their transitions
+    x.clear();
+    for (double v = -40.0; v <= 40.0; v += 0.000137)
+        x.push_back(v);
+    y = x;
+    approxTanh(y.data(), y.size());
+    for (size_t i = 0; i < x.size(); i++)
+        tanhError = max(tanhError, fabs(y[i] - tanh((double) x[i])));
+    y = x;
+    approxSigmoid(y.data(), y.size());
+    for (size_t i = 0; i < x.size(); i++)
+        sigmoidError = max(sigmoidError, fabs(y[i] - 1.0 / (1.0 + exp(-(double) x[i]))));
+}
+
+/**
+    Checks the errors of the approximated activation functions,
+    in double and single precision, against their bounds.
+
+    @return Number of functions exceeding their error bound.
+*/
+int checkActivations()
+{
+    double expError, tanhError, sigmoidError;
+    activationErrors<double>(700.0, expError, tanhError, sigmoidError);
+    printf("Approximated activations (%s): exp %.3g (relative), tanh %.3g, sigmoid %.3g\n",
+           approxInstructionSet(), expError, tanhError, sigmoidError);
+    int nFailures = (expError > APPROX_EXP_MAX_ERROR) + (tanhError > APPROX_TANH_MAX_ERROR)
+        + (sigmoidError > APPROX_SIGMOID_MAX_ERROR);
+
+    activationErrors<float>(87.0, expError, tanhError, sigmoidError);
+    printf("Approximated activations (%s, float): exp %.3g (relative), tanh %.3g, sigmoid %.3g\n",
+           approxInstructionSet(), expError, tanhError, sigmoidError);
+    nFailures += (expError > APPROX_EXP_MAX_ERROR_FLOAT) + (tanhError > APPROX_TANH_MAX_ERROR_FLOAT)
+        + (sigmoidError > APPROX_SIGMOID_MAX_ERROR_FLOAT);
+
+    if (nFailures > 0)
+        cerr << "approximated activations exceed their error bounds" << endl;
+    return nFailures;
+}
+
+/**
+    Compares results with a stored baseline.
+
+    @param path Path to the baseline.
+    @param results Current results.
+    @param tolerance Maximum relative slowdown.
+    @return Number of regressions.
+*/
+int compareBaseline(const char* path, const vector<tResult> &results, double tolerance)
+{
+    ifstream file(path);
+    if (!file.is_open())
+    {
+        cerr << "cannot open baseline " << path << endl;
+        return 0;
+    }
+    map<string, pair<double, double> > baseline;
+    string name;
+    double ns, allocs;
+    while (file >> name >> ns >> allocs)
+        baseline[name] = make_pair(ns, allocs);
+
+    int nRegressions = 0;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        map<string, pair<double, double> >::iterator it = baseline.find(results[i].name);
+        if (it == baseline.end())
+            continue;
+        bool slower = results[i].nsPerFrame > it->second.first * (1.0 + tolerance);
+        bool moreAllocs = results[i].allocsPerFrame > it->second.second + 0.5;
+        if (slower || moreAllocs)
+        {
+            nRegressions++;
+            printf("REGRESSION %-22s %10.1f ns/frame (baseline %.1f), %8.2f allocs/frame (baseline %.2f)\n",
+                   results[i].name.c_str(), results[i].nsPerFrame, it->second.first,
+                   results[i].allocsPerFrame, it->second.second);
+        }
+    }
+    return nRegressions;
+}
+
+/**
+    Stores results as a baseline for future runs.
+
+    @param path Path to the baseline.
+    @param results Current results.
+*/
+void saveBaseline(const char* path, const vector<tResult> &results)
+{
+    ofstream file(path);
+    if (!file.is_open())
+    {
+        cerr << "cannot save baseline " << path << endl;
+        return;
+    }
+    for (size_t i = 0; i < results.size(); i++)
+        file << results[i].name << " " << results[i].nsPerFrame << " " << results[i].allocsPerFrame << "\n";
+}
+
+int main(int argc, char *argv[])
+{
+    char framesPath[1000] = "";
+    char modelPath[1000] = "";
+    char savePath[1000] = "";
+    char baselinePath[1000] = "";
+    double minSeconds = 0.2;
+    double tolerance = 0.2;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "frames:", 7) == 0)
+            sscanf(argv[i], "frames:%s", framesPath);
+        else if (strncmp(argv[i], "model:", 6) == 0)
+            sscanf(argv[i], "model:%s", modelPath);
+        else if (strncmp(argv[i], "save:", 5) == 0)
+            sscanf(argv[i], "save:%s", savePath);
+        else if (strncmp(argv[i], "baseline:", 9) == 0)
+            sscanf(argv[i], "baseline:%s", baselinePath);
+        else if (strncmp(argv[i], "time:", 5) == 0)
+            sscanf(argv[i], "time:%lf", &minSeconds);
+        else if (strncmp(argv[i], "tolerance:", 10) == 0)
+            sscanf(argv[i], "tolerance:%lf", &tolerance);
+    }
+
+    // Load or synthesize the corpus
+    vector<string> frames;
+    if (framesPath[0] != '\0')
+    {
+        if (!loadFrames(framesPath, frames))
+        {
+            cerr << "cannot read frames from " << framesPath << endl;
+            return 1;
+        }
+        cout << "Corpus: " << frames.size() << " frames from " << framesPath << endl;
+    }
+    else
+    {
+        synthesizeFrames(2000, frames);
+        cout << "Corpus: " << frames.size() << " synthetic frames (half of them noisy)" << endl;
+    }
+
+    if (checkDecoding(frames) > 0)
+        return 1;
+
+    // Pre-decoded states and actions for the encoders,
+    // and the corpus as binary frames
+    vector<CarState> states;
+    vector<CarControl> actions;
+    vector<string> binaryFrames;
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        CarState cs(frames[i]);
+        states.push_back(cs);
+        actions.push_back(CarControl(cs.speedX / 300.0f, 0.0f, cs.gear, cs.angle, 0.0f, 0, 0));
+        char frame[1000];
+        binaryFrames.push_back(string(frame, cs.encodeBinary(frame, sizeof(frame))));
+    }
+
+    JerryTheRaceCarDriver driver;
+    if (modelPath[0] != '\0')
+        driver.setModelLocation(modelPath, false);
+
+    vector<tResult> results;
+    size_t k;
+    char buf[1000];
+
+    results.push_back(run("decode/SimpleParser", frames, minSeconds, [](const string &s) {
+        CarState cs;
+        decodeWithSimpleParser(s, cs);
+        sink = cs.track[9];
+    }));
+
+    results.push_back(run("decode/CarState", frames, minSeconds, [](const string &s) {
+        CarState cs;
+        cs.parse(s.data(), s.size());
+        sink = cs.track[9];
+    }));
+
+    results.push_back(run("decode/CarState-masked", frames, minSeconds, [](const string &s) {
+        CarState cs;
+        cs.parse(s.data(), s.size(), JerryTheRaceCarDriver::SENSORS);
+        sink = cs.track[9];
+    }));
+
+    results.push_back(run("decode/CarState-binary", binaryFrames, minSeconds, [](const string &s) {
+        CarState cs;
+        cs.parse(s.data(), s.size());
+        sink = cs.track[9];
+    }));
+
+    k = 0;
+    results.push_back(run("encode/toString", frames, minSeconds, [&](const string &) {
+        sink = actions[k].toString().size();
+        k = (k + 1) % actions.size();
+    }));
+
+    k = 0;
+    results.push_back(run("encode/buffer", frames, minSeconds, [&](const string &) {
+        sink = actions[k].encode(buf, sizeof(buf));
+        k = (k + 1) % actions.size();
+    }));
+
+    k = 0;
+    results.push_back(run("encode/binary", frames, minSeconds, [&](const string &) {
+        sink = actions[k].encodeBinary(buf, sizeof(buf));
+        k = (k + 1) % actions.size();
+    }));
+
+    // Activations of a layer of the target speed network, and of a wider one
+    const size_t layerSizes[] = { 7, 64 };
+    for (size_t n : layerSizes)
+    {
+        vector<double> inputs(n), layer(n);
+        for (size_t i = 0; i < n; i++)
+            inputs[i] = 4.0 * i / n - 2.0;
+        string suffix = "-" + to_string(n);
+
+        results.push_back(run("act/tanh-libm" + suffix, frames, minSeconds, [&](const string &) {
+            for (size_t i = 0; i < n; i++)
+                layer[i] = tanh(inputs[i]);
+            sink = layer[0];
+        }));
+        results.push_back(run("act/tanh-approx" + suffix, frames, minSeconds, [&](const string &) {
+            copy(inputs.begin(), inputs.end(), layer.begin());
+            approxTanh(layer.data(), n);
+            sink = layer[0];
+        }));
+        results.push_back(run("act/sigmoid-libm" + suffix, frames, minSeconds, [&](const string &) {
+            for (size_t i = 0; i < n; i++)
+                layer[i] = 1.0 / (1.0 + exp(-inputs[i]));
+            sink = layer[0];
+        }));
+        results.push_back(run("act/sigmoid-approx" + suffix, frames, minSeconds, [&](const string &) {
+            copy(inputs.begin(), inputs.end(), layer.begin());
+            approxSigmoid(layer.data(), n);
+            sink = layer[0];
+        }));
+    }
+
+    // Single exponential, as in the acceleration/brake module
+    vector<double> deviations(16);
+    for (size_t i = 0; i < deviations.size(); i++)
+        deviations[i] = 0.5 * i - 4.0;
+    k = 0;
+    results.push_back(run("act/exp-libm-1", frames, minSeconds, [&](const string &) {
+        sink = exp(deviations[k]);
+        k = (k + 1) % deviations.size();
+    }));
+    k = 0;
+    results.push_back(run("act/exp-approx-1", frames, minSeconds, [&](const string &) {
+        sink = approxExp(deviations[k]);
+        k = (k + 1) % deviations.size();
+    }));
+
+    // Target speed network (7-7-7-1), with dynamic and fixed sizes,
+    // and in single precision
+    MLP dynamicNetwork(7);
+    dynamicNetwork.addFullyConnectedLayer(7, 7);
+    dynamicNetwork.addActivation(ACTIVATION_TANH);
+    dynamicNetwork.addFullyConnectedLayer(7, 7);
+    dynamicNetwork.addActivation(ACTIVATION_TANH);
+    dynamicNetwork.addFullyConnectedLayer(7, 1);
+    dynamicNetwork.addActivation(ACTIVATION_CLIPPING);
+    dynamicNetwork.initWeights();
+    FixedMLP<Dense<7, 7, Tanh>, Dense<7, 7, Tanh>, Dense<7, 1, Clipping>> fixedNetwork;
+    fixedNetwork.setWeights(dynamicNetwork.getWeights());
+    FixedMLP<Dense<7, 7, Tanh, float>, Dense<7, 7, Tanh, float>, Dense<7, 1, Clipping, float>> floatNetwork;
+    floatNetwork.setWeights(dynamicNetwork.getWeights().cast<float>());
+
+    k = 0;
+    results.push_back(run("mlp/dynamic", frames, minSeconds, [&](const string &) {
+        for (int i = 0; i < 7; i++)
+            dynamicNetwork.in(i) = states[k].track[6 + i] / 200.0;
+        dynamicNetwork.forward();
+        sink = dynamicNetwork.out(0);
+        k = (k + 1) % states.size();
+    }));
+
+    k = 0;
+    results.push_back(run("mlp/fixed", frames, minSeconds, [&](const string &) {
+        for (int i = 0; i < 7; i++)
+            fixedNetwork.in(i) = states[k].track[6 + i] / 200.0;
+        fixedNetwork.forward();
+        sink = fixedNetwork.out(0);
+        k = (k + 1) % states.size();
+    }));
+
+    k = 0;
+    results.push_back(run("mlp/fixed-float", frames, minSeconds, [&](const string &) {
+        for (int i = 0; i < 7; i++)
+            floatNetwork.in(i) = states[k].track[6 + i] / 200.0f;
+        floatNetwork.forward();
+        sink = floatNetwork.out(0);
+        k = (k + 1) % states.size();
+    }));
+
+    // Target speed module over batches of states, with its own parameters
+    // and with those of a whole swarm; a batch is computed every BATCH
+    // frames, so the times are per state
+    const size_t BATCH = 64;
+    const size_t SWARM = 50;
+    const size_t nBatched = (states.size() / BATCH) * BATCH;
+    TargetSpeedModule<double> speedModule;
+    TargetSpeedModule<double>::tMatrix swarm(speedModule.getNumberOfParameters(), SWARM);
+    Eigen::VectorXd lbs = speedModule.getLowerBounds();
+    Eigen::VectorXd ubs = speedModule.getUpperBounds();
+    for (size_t p = 0; p < SWARM; p++)
+        swarm.col(p) = lbs + randUniform(lbs.size()).cwiseProduct(ubs - lbs);
+    speedModule.setParameters(swarm.col(0));
+    Eigen::VectorXd batchSpeeds;
+    TargetSpeedModule<double>::tMatrix swarmSpeeds;
+
+    k = 0;
+    results.push_back(run("speed/batch-" + to_string(BATCH), frames, minSeconds, [&](const string &) {
+        if (k % BATCH == 0)
+        {
+            speedModule.controlBatch(&states[k], BATCH, batchSpeeds);
+            sink = batchSpeeds[0];
+        }
+        k = (k + 1) % nBatched;
+    }));
+
+    k = 0;
+    results.push_back(run("speed/swarm-" + to_string(SWARM), frames, minSeconds, [&](const string &) {
+        if (k % BATCH == 0)
+        {
+            speedModule.controlBatch(&states[k], BATCH, swarm, swarmSpeeds);
+            sink = swarmSpeeds(0, 0);
+        }
+        k = (k + 1) % nBatched;
+    }));
+
+    // Switching the controller to another particle position
+    Controller controller;
+    Eigen::VectorXd position = controller.getParameters();
+    results.push_back(run("params/setParameters", frames, minSeconds, [&](const string &) {
+        controller.setParameters(position);
+    }));
+
+    // Frames 20 ms apart, extrapolated over one tick
+    StatePredictor predictor(1.0);
+    predictor.recordLatency(20000);
+    int64_t t = 0;
+    k = 0;
+    results.push_back(run("predict/StatePredictor", frames, minSeconds, [&](const string &) {
+        t += 20000000;
+        sink = predictor.predict(states[k], t).angle;
+        k = (k + 1) % states.size();
+    }));
+
+    results.push_back(run("drive/string", frames, minSeconds, [&](const string &s) {
+        sink = driver.drive(s).size();
+    }));
+
+    results.push_back(run("drive/buffer", frames, minSeconds, [&](const string &s) {
+        sink = driver.drive(s, buf, sizeof(buf));
+    }));
+
+    results.push_back(run("drive/binary", binaryFrames, minSeconds, [&](const string &s) {
+        sink = driver.drive(s, buf, sizeof(buf));
+    }));
+
+    // Report
+    printf("%-24s %12s %14s %14s %10s\n", "benchmark", "ns/frame", "allocs/frame", "frames/s", "MB/s");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        printf("%-24s %12.1f %14.2f %14.0f %10.1f\n", results[i].name.c_str(), results[i].nsPerFrame,
+               results[i].allocsPerFrame, results[i].framesPerSecond, results[i].megabytesPerSecond);
+    }
+
+    if (checkActivations() > 0)
+        return 1;
+
+    if (savePath[0] != '\0')
+        saveBaseline(savePath, results);
+    if (baselinePath[0] != '\0')
+    {
+        int nRegressions = compareBaseline(baselinePath, results, tolerance);
+        if (nRegressions > 0)
+            return 1;
+        cout << "No regression against " << baselinePath << endl;
+    }
+    return 0;
+}
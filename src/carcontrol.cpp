@@ -20,32 +20,44 @@ CarControl::CarControl(string sensors) {
 }
 
 std::string CarControl::toString() {
-    std::string str;
-    str  = SimpleParser::stringify("accel", accel);
-    str += SimpleParser::stringify("brake", brake);
-    str += SimpleParser::stringify("gear",  gear);
-    str += SimpleParser::stringify("steer", steer);
-    str += SimpleParser::stringify("clutch", clutch);
-    str += SimpleParser::stringify("focus",  focus);
-    str += SimpleParser::stringify("meta", meta);
-    return str;    
+    return codec::encode(CAR_CONTROL_SCHEMA, *this);
+}
+
+/**
+    Writes the action message into a caller-provided buffer
+    (typically the UDP send buffer), without any allocation.
+
+    @param buffer Destination buffer.
+    @param size Capacity of the buffer.
+    @return Length of the null-terminated message, or 0 if
+        it does not fit in the buffer.
+*/
+size_t CarControl::encode(char* buffer, size_t size) const {
+    return codec::encode(CAR_CONTROL_SCHEMA, *this, buffer, size);
+}
+
+/**
+    Writes the action as a binary frame (see schema.h) into
+    a caller-provided buffer, without any allocation.
+
+    @param buffer Destination buffer.
+    @param size Capacity of the buffer.
+    @return Length of the frame, or 0 if it does not fit in the buffer.
+*/
+size_t CarControl::encodeBinary(char* buffer, size_t size) const {
+    return codec::encodeBinary(CAR_CONTROL_SCHEMA, *this, buffer, size);
 }
 
 void  CarControl::fromString(string sensors) {
-    if (SimpleParser::parse(sensors, "accel", accel)==false)
-        accel=0.0;
-    if (SimpleParser::parse(sensors, "brake", brake)==false)
-        brake=0.0;
-    if (SimpleParser::parse(sensors, "gear",  gear)==false)
-        gear=1;
-    if (SimpleParser::parse(sensors, "steer", steer)==false)
-        steer=0.0;
-    if (SimpleParser::parse(sensors, "clutch", clutch)==false)
-            clutch=0.0;
-    if (SimpleParser::parse(sensors, "meta", meta)==false)
-        meta=0;
-    if (SimpleParser::parse(sensors, "focus", focus)==false) //ML
-        focus=0; //ML
+    // Default values of the actuators missing from the message
+    accel = 0.0;
+    brake = 0.0;
+    gear = 1;
+    steer = 0.0;
+    clutch = 0.0;
+    meta = 0;
+    focus = 0; //ML
+    codec::decode(CAR_CONTROL_SCHEMA, sensors.data(), sensors.size(), *this);
     if (focus < -90 || focus > 90)//ML What to do with focus requests out of allowed range?
         focus=360;//ML A value of 360 is used for not requesting focus readings; -1 is returned as focus reading to the client
 }
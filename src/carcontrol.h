@@ -15,6 +15,7 @@
 #include <cassert>
 
 #include "SimpleParser.h"
+#include "schema.h"
 
 
 class CarControl {
@@ -50,6 +51,27 @@ public:
 
     std::string toString();
     void fromString(std::string sensors);
+
+    // Writes the action message into a buffer without allocating
+    size_t encode(char* buffer, size_t size) const;
+
+    // Writes the action as a binary frame into a buffer
+    size_t encodeBinary(char* buffer, size_t size) const;
+};
+
+
+// Actuators sent to the server, in serialization order
+inline constexpr Field CAR_CONTROL_FIELDS[] = {
+    SCHEMA_FIELD(CarControl, accel),
+    SCHEMA_FIELD(CarControl, brake),
+    SCHEMA_FIELD(CarControl, gear),
+    SCHEMA_FIELD(CarControl, steer),
+    SCHEMA_FIELD(CarControl, clutch),
+    SCHEMA_FIELD(CarControl, focus),
+    SCHEMA_FIELD(CarControl, meta),
 };
 
+// Action message schema
+inline constexpr auto CAR_CONTROL_SCHEMA = makeSchema(CAR_CONTROL_FIELDS);
+
 #endif // CARCONTROL_H__
@@ -0,0 +1,35 @@
+/**
+    carfeatures.cpp
+    Quantities derived from the car state, shared by the modules
+
+    @author Antoine Passemiers
+    @version 1.0 18/08/2019
+*/
+
+#include "carfeatures.h"
+
+
+/**
+    Computes the features of a car state.
+
+    @param cs Current car state.
+*/
+template <typename T>
+void CarFeatures<T>::compute(const CarState &cs) {
+    this->speed = cs.getSpeed();
+    this->wheels_speed = cs.getWheelsSpeed();
+    this->slip = this->speed - this->wheels_speed;
+    this->on_track = (std::abs(cs.trackPos) <= 1);
+
+    this->front_track_sum = 0;
+    for (int i = -4; i < 5; i++) {
+        this->front_track_sum += cs.track[FRONT + i];
+    }
+    for (int i = 0; i < TRACK_SENSORS_NUM; i++) {
+        this->track[i] = cs.track[i] / TRACK_RANGE;
+    }
+}
+
+
+template struct CarFeatures<float>;
+template struct CarFeatures<double>;
@@ -0,0 +1,53 @@
+/**
+    carfeatures.h
+    Quantities derived from the car state, shared by the modules
+
+    @author Antoine Passemiers
+    @version 1.0 18/08/2019
+*/
+
+#ifndef CARFEATURES_H__
+#define CARFEATURES_H__
+
+#include "carstate.h"
+
+
+/**
+    Quantities derived from a car state, computed once per frame and
+    read by all the modules. The frame fits the cache lines it is
+    aligned on, and is meant to live on the stack of the control step.
+
+    @param T Scalar type of the modules.
+*/
+template <typename T>
+struct alignas(64) CarFeatures {
+    // Index of the front track sensor
+    static constexpr int FRONT = 9;
+
+    // Range of the track sensors (in meters)
+    static constexpr T TRACK_RANGE = 200;
+
+    // Norm of the velocity (see CarState::getSpeed)
+    T speed;
+
+    // Ground speed of the wheels (see CarState::getWheelsSpeed)
+    T wheels_speed;
+
+    // Speed in excess of the ground speed of the wheels
+    T slip;
+
+    // Whether the car is between the track borders
+    bool on_track;
+
+    // Sum of the 9 track sensors around the front one
+    T front_track_sum;
+
+    // Track sensors divided by their range
+    T track[TRACK_SENSORS_NUM];
+
+    // Computes the features of a car state
+    void compute(const CarState &cs);
+};
+
+
+#endif // CARFEATURES_H__
@@ -6,33 +6,40 @@
     @version 1.0 05/08/2019
 */
 
-#include "CarState.h"
+#include "carstate.h"
 
 
 /**
     Constructs car state from a string message received
     from the server.
 */
-CarState::CarState(std::string sensors) {
-    SimpleParser::parse(sensors, "angle", this->angle);
-    SimpleParser::parse(sensors, "curLapTime", this->curLapTime);
-    SimpleParser::parse(sensors, "damage", this->damage);
-    SimpleParser::parse(sensors, "distFromStart", this->distFromStart);
-    SimpleParser::parse(sensors, "distRaced", this->distRaced);
-    SimpleParser::parse(sensors, "focus", this->focus, FOCUS_SENSORS_NUM);
-    SimpleParser::parse(sensors, "fuel", this->fuel);
-    SimpleParser::parse(sensors, "gear", this->gear);
-    SimpleParser::parse(sensors, "lastLapTime", this->lastLapTime);
-    SimpleParser::parse(sensors, "opponents", this->opponents, OPPONENTS_SENSORS_NUM);
-    SimpleParser::parse(sensors, "racePos", this->racePos);
-    SimpleParser::parse(sensors, "rpm", this->rpm);
-    SimpleParser::parse(sensors, "speedX", this->speedX);
-    SimpleParser::parse(sensors, "speedY", this->speedY);
-    SimpleParser::parse(sensors, "speedZ", this->speedZ);
-    SimpleParser::parse(sensors, "track", this->track, TRACK_SENSORS_NUM);
-    SimpleParser::parse(sensors, "trackPos", this->trackPos);
-    SimpleParser::parse(sensors, "wheelSpinVel", this->wheelSpinVel, 4);
-    SimpleParser::parse(sensors, "z", this->z);
+CarState::CarState(std::string sensors) : CarState(sensors.data(), sensors.size()) {}
+
+/**
+    Constructs car state from a message received from the server,
+    without copying it.
+
+    @param sensors Message buffer (not necessarily null-terminated).
+    @param length Number of characters in the message.
+*/
+CarState::CarState(const char* sensors, size_t length) {
+    this->parse(sensors, length);
+}
+
+/**
+    Fills the car state from a message received from the server,
+    walking the message only once (see codec::decode).
+    Sensors that are missing from the message or not selected
+    by the mask are left unchanged.
+
+    @param sensors Message buffer (not necessarily null-terminated).
+    @param length Number of characters in the message.
+    @param mask Sensors to be decoded (see sensorMask).
+    @return Whether all the sensors were found in the message.
+*/
+bool CarState::parse(const char* sensors, size_t length, unsigned int mask) {
+    int n_found = codec::decode(CAR_STATE_SCHEMA, sensors, length, *this, mask);
+    return (n_found == static_cast<int>(CAR_STATE_SCHEMA.size));
 }
 
 /**
@@ -40,7 +47,7 @@ CarState::CarState(std::string sensors) {
 
     @return Average wheel speed.
 */
-float CarState::getWheelsSpeed() {
+float CarState::getWheelsSpeed() const {
     // Compute average wheel angular speed
     float velocity = 0.0;
     for (int i = 0; i < 4; i++) {
@@ -49,8 +56,9 @@ float CarState::getWheelsSpeed() {
     velocity /= 4.0;
 
     // Convert angular speed to ground speed
-    double wheel_radius = 0.3325;
-    return velocity * wheel_radius * 4.0 * std::pow(M_PI, 2);
+    constexpr double wheel_radius = 0.3325;
+    constexpr double pi_squared = M_PI * M_PI;
+    return velocity * wheel_radius * 4.0 * pi_squared;
 }
 
 /**
@@ -58,7 +66,7 @@ float CarState::getWheelsSpeed() {
 
     @return Current car speed.
 */
-float CarState::getSpeed() {
+float CarState::getSpeed() const {
     // Compute the norm
     float sx = this->speedX;
     float sy = this->speedY;
@@ -72,25 +80,17 @@ float CarState::getSpeed() {
     @return A string message
 */
 string CarState::toString() {
-	std::string str;
-	str  = SimpleParser::stringify("angle", this->angle);
-	str += SimpleParser::stringify("curLapTime", this->curLapTime);
-	str += SimpleParser::stringify("damage", this->damage);
-	str += SimpleParser::stringify("distFromStart", this->distFromStart);
-	str += SimpleParser::stringify("distRaced", this->distRaced);
-	str += SimpleParser::stringify("focus", this->focus, FOCUS_SENSORS_NUM);
-	str += SimpleParser::stringify("fuel", this->fuel);
-	str += SimpleParser::stringify("gear", this->gear);
-	str += SimpleParser::stringify("lastLapTime", this->lastLapTime);
-	str += SimpleParser::stringify("opponents", this->opponents, OPPONENTS_SENSORS_NUM);
-	str += SimpleParser::stringify("racePos", this->racePos);
-	str += SimpleParser::stringify("rpm", this->rpm);
-	str += SimpleParser::stringify("speedX", this->speedX);
-	str += SimpleParser::stringify("speedY", this->speedY);
-	str += SimpleParser::stringify("speedZ", this->speedZ);
-	str += SimpleParser::stringify("track", this->track, TRACK_SENSORS_NUM);
-	str += SimpleParser::stringify("trackPos", this->trackPos);
-	str += SimpleParser::stringify("wheelSpinVel", this->wheelSpinVel, 4);
-	str += SimpleParser::stringify("z", this->z);
-	return str;
+	return codec::encode(CAR_STATE_SCHEMA, *this);
+}
+
+/**
+    Writes the car state as a binary frame (see schema.h)
+    into a caller-provided buffer, without any allocation.
+
+    @param buffer Destination buffer.
+    @param size Capacity of the buffer.
+    @return Length of the frame, or 0 if it does not fit in the buffer.
+*/
+size_t CarState::encodeBinary(char* buffer, size_t size) const {
+    return codec::encodeBinary(CAR_STATE_SCHEMA, *this, buffer, size);
 }
@@ -16,10 +16,13 @@
 #include <cassert>
 #include <cstdlib>
 #include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
 #include "SimpleParser.h"
+#include "schema.h"
 
 
 class CarState {
@@ -81,16 +84,62 @@ public:
         // Constructors and destructor
 		CarState() = default;
         CarState(std::string sensors);
+        CarState(const char* sensors, size_t length);
         ~CarState() = default;
 
+        // Fill the sensors from a message in a single pass
+        bool parse(const char* sensors, size_t length, unsigned int mask = codec::ALL_FIELDS);
+
         // Get average wheel speed
-        float getWheelsSpeed();
+        float getWheelsSpeed() const;
 
         // Get car speed
-        float getSpeed();
+        float getSpeed() const;
 
         // Convert to string
         string toString();
+
+        // Write as a binary frame into a buffer
+        size_t encodeBinary(char* buffer, size_t size) const;
+};
+
+
+// Sensors sent by the server, in serialization order
+inline constexpr Field CAR_STATE_FIELDS[] = {
+    SCHEMA_FIELD(CarState, angle),
+    SCHEMA_FIELD(CarState, curLapTime),
+    SCHEMA_FIELD(CarState, damage),
+    SCHEMA_FIELD(CarState, distFromStart),
+    SCHEMA_FIELD(CarState, distRaced),
+    SCHEMA_FIELD(CarState, focus),
+    SCHEMA_FIELD(CarState, fuel),
+    SCHEMA_FIELD(CarState, gear),
+    SCHEMA_FIELD(CarState, lastLapTime),
+    SCHEMA_FIELD(CarState, opponents),
+    SCHEMA_FIELD(CarState, racePos),
+    SCHEMA_FIELD(CarState, rpm),
+    SCHEMA_FIELD(CarState, speedX),
+    SCHEMA_FIELD(CarState, speedY),
+    SCHEMA_FIELD(CarState, speedZ),
+    SCHEMA_FIELD(CarState, track),
+    SCHEMA_FIELD(CarState, trackPos),
+    SCHEMA_FIELD(CarState, wheelSpinVel),
+    SCHEMA_FIELD(CarState, z),
 };
 
+// Sensor message schema
+inline constexpr auto CAR_STATE_SCHEMA = makeSchema(CAR_STATE_FIELDS);
+
+/**
+    Bit mask selecting a sensor, to be combined with | in order to
+    declare which sensors must be decoded. Unknown tags do not compile.
+
+    @param tag Tag of the sensor.
+    @return Bit mask of the sensor.
+*/
+template <size_t L>
+constexpr unsigned int sensorMask(const char (&tag)[L]) {
+    return fieldMask(CAR_STATE_SCHEMA, tag);
+}
+
 #endif // CARSTATE_H__
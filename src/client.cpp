@@ -20,49 +20,63 @@
 
 #ifdef WIN32
 #include <WinSock.h>
-#else
-#include <netdb.h>
-#include <netinet/in.h>
-#include <unistd.h>
 #endif
 
 #include <string>
+#include <string_view>
 #include<random>
 #include <iostream>
 #include <cstdlib>
 #include <cstdio>
+#include <cmath>
+#include "flightlog.h"
+#include "latency.h"
+#include "pipeline.h"
+#include "realtime.h"
+#include "transport.h"
 #include __DRIVER_INCLUDE__
 
 /*** defines for UDP *****/
 #define UDP_MSGLEN 1000
 #define UDP_CLIENT_TIMEUOT 1000000
+#define UDP_INIT_BACKOFF_MIN 100000  // shortest first identification timeout (us), doubled up to UDP_CLIENT_TIMEUOT
+#define STALE_FRAME_WINDOW 1.0  // max curLapTime step back (s) for a frame to be considered reordered
+#define WARMUP_STEPS 2000  // synthetic steps run by the controller before identification in realtime mode
 //#define __UDP_CLIENT_VERBOSE__
 /************************/
 
-#ifdef WIN32
-typedef sockaddr_in tSockAddrIn;
-#define CLOSE(x) closesocket(x)
-#define INVALID(x) x == INVALID_SOCKET
-#else
-typedef int SOCKET;
-typedef struct sockaddr_in tSockAddrIn;
-#define CLOSE(x) close(x)
-#define INVALID(x) x < 0
-#endif
 
 class __DRIVER_CLASS__;
 typedef __DRIVER_CLASS__ tDriver;
 
+/*** optional client features (see parse_args) ***/
+typedef struct
+{
+    char framesPath[1000];      // file where received sensor strings are appended ("" if none)
+    char logPath[1000];         // flight log of controller inputs and actions ("" if none)
+    bool drain;                 // answer only the newest queued frame
+    long budget;                // compute budget per step in microseconds (0 if none)
+    char transport[1000];       // "udp", "unix:<path>" or "shm:<name>" (see transport.h)
+    bool binary;                // offer binary frames during identification
+    bool pipeline;              // network, control and telemetry on separate threads
+    int cpu;                    // core of the thread driving the car, or of the network thread
+                                // in pipeline mode (-1 if not pinned)
+    bool realtime;              // lock and prefault memory, and warm up before the race
+    int fifo;                   // SCHED_FIFO priority requested for the thread driving the car (0 if none)
+    double predict;             // ticks the state is extrapolated over, besides the latency (negative if none)
+} tClientOptions;
+
 
 using namespace std;
 
 
 void parse_args(int argc, char *argv[], char *hostName, unsigned int &serverPort, char *id, unsigned int &maxEpisodes,
-          unsigned int &maxSteps, char *trackName, JerryTheRaceCarDriver::tstage &stage, bool &train, char* model_path, unsigned int &seed);
+          unsigned int &maxSteps, char *trackName, JerryTheRaceCarDriver::tstage &stage, bool &train, char* model_path, unsigned int &seed,
+          tClientOptions &options);
 
 int main(int argc, char *argv[])
 {
-    SOCKET socketDescriptor;
+    Transport* transport;
     int numRead;
 
     unsigned int seed;
@@ -79,12 +93,19 @@ int main(int argc, char *argv[])
 //    long seed;
     char trackName[1000];
     JerryTheRaceCarDriver::tstage stage;
+    tClientOptions options;
 
-    tSockAddrIn serverAddress;
-    struct hostent *hostInfo;
-    struct timeval timeVal;
-    fd_set readSet;
     char buf[UDP_MSGLEN];
+    char drainBuf[UDP_MSGLEN];
+    char lastAction[UDP_MSGLEN] = "";
+    size_t lastActionLength = 0;
+
+    // Time between datagram arrival and action send, and between arrivals
+    LatencyHistogram latency;
+    LatencyHistogram interArrival;
+
+    // Time between datagram arrival and action send, over all the episodes
+    LatencyHistogram raceLatency;
 
 
 #ifdef WIN32 
@@ -103,20 +124,13 @@ int main(int argc, char *argv[])
 
 //    parse_args(argc,argv,hostName,serverPort,id,maxEpisodes,maxSteps,noise,noiseAVG,noiseSTD,seed,trackName,stage);
 
-    parse_args(argc,argv,hostName,serverPort,id,maxEpisodes,maxSteps,trackName,stage,train,model_path,seed);
+    parse_args(argc,argv,hostName,serverPort,id,maxEpisodes,maxSteps,trackName,stage,train,model_path,seed,options);
 
 //    if (seed>0)
 //      srand(seed);
 //    else
 //      srand(time(NULL));
 
-    hostInfo = gethostbyname(hostName);
-    if (hostInfo == NULL)
-    {
-        cout << "Error: problem interpreting host: " << hostName << "\n";
-        exit(1);
-    }
-
     // Print command line option used
     cout << "***********************************" << endl;
 
@@ -124,6 +138,8 @@ int main(int argc, char *argv[])
 
     cout << "PORT: " << serverPort  << endl;
 
+    cout << "TRANSPORT: " << options.transport << endl;
+
     cout << "ID: "   << id     << endl;
 
     cout << "MAX_STEPS: " << maxSteps << endl; 
@@ -145,27 +161,103 @@ int main(int argc, char *argv[])
         cout << "STAGE: UNKNOWN" << endl;
 
     cout << "***********************************" << endl;
-    // Create a socket (UDP on IPv4 protocol)
-    socketDescriptor = socket(AF_INET, SOCK_DGRAM, 0);
-    if (INVALID(socketDescriptor))
-    {
-        cerr << "cannot create socket\n";
+    // Open the channel to the server (UDP on IPv4 protocol by default)
+    transport = openTransport(options.transport, hostName, serverPort, false);
+    if (transport == NULL)
         exit(1);
-    }
-
-    // Set some fields in the serverAddress structure.
-    serverAddress.sin_family = hostInfo->h_addrtype;
-    memcpy((char *) &serverAddress.sin_addr.s_addr,
-           hostInfo->h_addr_list[0], hostInfo->h_length);
-    serverAddress.sin_port = htons(serverPort);
 
     tDriver d;
     strcpy(d.trackName,trackName);
     d.stage = stage;
     d.setModelLocation(model_path, train);
+    d.setBudget(options.budget);
+    d.setPrediction(options.predict);
 
     srand((unsigned int) seed);
 
+    // Sensor strings can be recorded for the benchmarks (one per line)
+    FILE *framesFile = NULL;
+    if (options.framesPath[0] != '\0')
+    {
+        framesFile = fopen(options.framesPath, "a");
+        if (framesFile == NULL)
+            cerr << "cannot open " << options.framesPath << "\n";
+    }
+
+    // Decoded states and actions can be recorded for offline replay
+    FlightLog flightLog;
+    if (options.logPath[0] != '\0' && !flightLog.open(options.logPath))
+        cerr << "cannot open " << options.logPath << "\n";
+
+    // In pipeline mode, the main thread only does the networking
+    Pipeline* pipeline = NULL;
+    if (options.pipeline)
+        pipeline = new Pipeline(transport, d, (options.logPath[0] != '\0') ? &flightLog : NULL,
+                                framesFile, options.cpu);
+
+    // The thread driving the car can be pinned (in pipeline mode,
+    // the control thread is pinned next to the network thread)
+    if (pipeline == NULL && options.cpu >= 0 && !pinThread(pthread_self(), options.cpu))
+        cerr << "cannot pin the client to cpu " << options.cpu << endl;
+
+    // Real-time mode: memory is locked and mapped beforehand, the thread
+    // driving the car is scheduled first if permitted, and the controller
+    // is warmed up before the server starts the race
+    if (options.realtime)
+    {
+        if (lockMemory())
+            cout << "Memory locked" << endl;
+        else
+            cerr << "cannot lock memory (see ulimit -l), running unlocked" << endl;
+        prefaultMemory(REALTIME_PREFAULT_STACK, REALTIME_PREFAULT_HEAP);
+
+        int64_t start = monotonicNanoseconds();
+        d.warmUp(WARMUP_STEPS);
+        cout << "Warm-up: " << WARMUP_STEPS << " steps in "
+             << (monotonicNanoseconds() - start) / 1e6 << " ms" << endl;
+    }
+    // The pipeline threads wait by yielding, which does not let the
+    // other threads run under SCHED_FIFO unless they have their own cores
+    if (options.fifo > 0 && pipeline != NULL && thread::hardware_concurrency() <= 2)
+    {
+        cerr << "SCHED_FIFO needs a core per pipeline thread, keeping the default scheduling" << endl;
+        options.fifo = 0;
+    }
+    if (options.fifo > 0)
+    {
+        std::thread::native_handle_type controlThread =
+            (pipeline != NULL) ? pipeline->controlThread() : pthread_self();
+        if (requestFifoScheduling(controlThread, options.fifo))
+            cout << "Scheduling: SCHED_FIFO, priority " << options.fifo << endl;
+        else
+            cerr << "SCHED_FIFO not permitted, keeping the default scheduling" << endl;
+    }
+
+    // Initialize the angles of rangefinders: the identification
+    // string is the same for all the episodes
+    float angles[19];
+    d.init(angles);
+    string initString = SimpleParser::stringify(string("init"),angles,19);
+    initString.insert(0,id);
+
+    // Binary frames are offered to the server, which accepts them by
+    // adding the same group to its answer (otherwise, text is used)
+    string binaryOffer = "(binary " + to_string(BINARY_FRAME_VERSION) + ")";
+    if (options.binary)
+        initString += binaryOffer;
+
+    // Time from the end of an episode to the identification for the next one
+    LatencyHistogram identification;
+    int64_t episodeEnd = 0;
+
+    // The simulator reads one message per step, hence an init string
+    // resent while the answer to the previous one is on its way would be
+    // read as an action, shifting all the actions of the episode. The
+    // first timeout is twice the slowest answer to a re-identification
+    // (UDP_CLIENT_TIMEUOT until one is measured), and is doubled from there
+    long initBackoff = UDP_CLIENT_TIMEUOT;
+    int64_t slowestAnswer = 0;
+
     bool shutdownClient=false;
     unsigned long curEpisode=0;
     do
@@ -173,75 +265,114 @@ int main(int argc, char *argv[])
         /***********************************************************************************
         ************************* UDP client identification ********************************
         ***********************************************************************************/
+        long initTimeout = initBackoff;
+        unsigned int nAttempts = 0;
+        int64_t identifyStart = (episodeEnd != 0) ? episodeEnd : monotonicNanoseconds();
+        bool identified = false;
         do
         {
-            // Initialize the angles of rangefinders
-            float angles[19];
-            d.init(angles);
-            string initString = SimpleParser::stringify(string("init"),angles,19);
-            //cout << "Sending id to server: " << id << endl;
-            initString.insert(0,id);
             //cout << "Sending init string to the server: " << initString << endl;
-            if (sendto(socketDescriptor, initString.c_str(), initString.length(), 0,
-                       (struct sockaddr *) &serverAddress,
-                       sizeof(serverAddress)) < 0)
+            if (!transport->send(initString.c_str(), initString.length()))
             {
                 cerr << "cannot send data ";
-                CLOSE(socketDescriptor);
+                delete transport;
                 exit(1);
             }
-
-            // wait until answer comes back, for up to UDP_CLIENT_TIMEUOT micro sec
-            FD_ZERO(&readSet);
-            FD_SET(socketDescriptor, &readSet);
-            timeVal.tv_sec = 0;
-            timeVal.tv_usec = UDP_CLIENT_TIMEUOT;
-
-            if (select(socketDescriptor+1, &readSet, NULL, NULL, &timeVal))
+            nAttempts++;
+            int64_t initSent = monotonicNanoseconds();
+            int64_t initDeadline = initSent + initTimeout * 1000LL;
+
+            // wait until answer comes back, for up to initTimeout micro sec:
+            // other messages do not trigger a new attempt
+            int64_t now;
+            while (!identified && (now = monotonicNanoseconds()) < initDeadline)
             {
+                int64_t rxTime;
+                numRead = transport->receive(buf, UDP_MSGLEN, (initDeadline - now + 999) / 1000, rxTime);
+                if (numRead == 0)
+                    break;
+
                 // Read data sent by the solorace server
-                memset(buf, 0x0, UDP_MSGLEN);  // Zero out the buffer.
-                numRead = recv(socketDescriptor, buf, UDP_MSGLEN, 0);
                 if (numRead < 0)
                 {
                     cerr << "didn't get response from server...";
+                    break;
                 }
-        else
-        {
-                    cout << "Received: " << buf << endl;
+                cout << "Received: " << buf << endl;
+
+                if (strncmp(buf,"***identified***",16)==0)
+                {
+                    now = monotonicNanoseconds();
+                    int64_t elapsed = now - identifyStart;
+                    if (episodeEnd != 0)
+                        identification.record(elapsed);
 
-                    if (strcmp(buf,"***identified***")==0)
+                    // Only a single attempt tells how long the server takes to answer
+                    if (episodeEnd != 0 && nAttempts == 1)
                     {
-                            d.restart();
-                            break;
+                        slowestAnswer = max(slowestAnswer, now - initSent);
+                        initBackoff = min(max(2 * slowestAnswer / 1000, (int64_t) UDP_INIT_BACKOFF_MIN),
+                                          (int64_t) UDP_CLIENT_TIMEUOT);
                     }
+                    cout << "Identified in " << elapsed / 1e6 << " ms ("
+                         << nAttempts << " attempts)" << endl;
+                    if (options.binary)
+                        cout << "Frames: " << ((binaryOffer == buf+16) ? "binary" : "text") << endl;
+                    d.restart();
+                    identified = true;
                 }
-          }
+            }
+            initTimeout = min(2 * initTimeout, (long) UDP_CLIENT_TIMEUOT);
 
-        }  while(1);
+        }  while(!identified);
+
+        if (pipeline != NULL)
+        {
+            shutdownClient = pipeline->runEpisode(curEpisode, maxSteps, UDP_CLIENT_TIMEUOT);
+            episodeEnd = monotonicNanoseconds();
+            continue;
+        }
 
     unsigned long currentStep=0; 
+    unsigned long droppedFrames=0;
+    unsigned long staleFrames=0;
+    float lastCurLapTime=NAN;
+
+    // Kernel receive timestamps use the wall clock: they are mapped to the
+    // monotonic clock with an offset refreshed at each episode
+    transport->synchronizeClocks();
+    int64_t rxTime = 0, lastRxTime = 0, txTime;
+    latency.reset();
+    interArrival.reset();
 
         while(1)
         {
             // wait until answer comes back, for up to UDP_CLIENT_TIMEUOT micro sec
-            FD_ZERO(&readSet);
-            FD_SET(socketDescriptor, &readSet);
-            timeVal.tv_sec = 0;
-            timeVal.tv_usec = UDP_CLIENT_TIMEUOT;
-
-            if (select(socketDescriptor+1, &readSet, NULL, NULL, &timeVal))
+            numRead = transport->receive(buf, UDP_MSGLEN, UDP_CLIENT_TIMEUOT, rxTime);
+            if (numRead != 0)
             {
                 // Read data sent by the solorace server
-                memset(buf, 0x0, UDP_MSGLEN);  // Zero out the buffer.
-                numRead = recv(socketDescriptor, buf, UDP_MSGLEN, 0);
                 if (numRead < 0)
                 {
                     cerr << "didn't get response from server?";
-                    CLOSE(socketDescriptor);
+                    delete transport;
                     exit(1);
                 }
 
+                // Latest frame wins: frames that piled up while the client
+                // was busy are dropped, unless a restart/shutdown shows up
+                if (options.drain)
+                {
+                    int n;
+                    while (strncmp(buf,"***",3)!=0 &&
+                           (n = transport->receive(drainBuf, UDP_MSGLEN, 0, rxTime)) > 0)
+                    {
+                        memcpy(buf, drainBuf, n+1);
+                        numRead = n;
+                        droppedFrames++;
+                    }
+                }
+
 #ifdef __UDP_CLIENT_VERBOSE__
                 cout << "Received: " << buf << endl;
 #endif
@@ -251,6 +382,12 @@ int main(int argc, char *argv[])
                     if (d.readyToShutdown()) shutdownClient = true;
                     d.restart();
                     cout << "Client Shutdown" << endl;
+                    if (options.drain)
+                        cout << "Dropped frames: " << droppedFrames << " (stale: " << staleFrames
+                             << ") over " << currentStep << " steps" << endl;
+                    latency.report(cout, "Latency recv->send");
+                    raceLatency.add(latency);
+                    interArrival.report(cout, "Inter-arrival");
                     break;
                 }
 
@@ -258,42 +395,108 @@ int main(int argc, char *argv[])
                 {
                     d.restart();
                     cout << "Client Restart" << endl;
+                    if (options.drain)
+                        cout << "Dropped frames: " << droppedFrames << " (stale: " << staleFrames
+                             << ") over " << currentStep << " steps" << endl;
+                    latency.report(cout, "Latency recv->send");
+                    raceLatency.add(latency);
+                    interArrival.report(cout, "Inter-arrival");
                     break;
                 }
+
+                if (lastRxTime != 0)
+                    interArrival.record(rxTime - lastRxTime);
+                lastRxTime = rxTime;
+
+                // Duplicate or reordered frames (curLapTime did not move forward)
+                // are answered with the last action instead of being driven
+                if (options.drain)
+                {
+                    CarState probe;
+                    probe.curLapTime = NAN;
+                    probe.parse(buf, numRead, sensorMask("curLapTime"));
+                    if (probe.curLapTime <= lastCurLapTime &&
+                        probe.curLapTime > lastCurLapTime - STALE_FRAME_WINDOW)
+                    {
+                        staleFrames++;
+                        droppedFrames++;
+                        memcpy(buf, lastAction, UDP_MSGLEN);
+                        if (!transport->send(buf, lastActionLength+1))
+                        {
+                            cerr << "cannot send data ";
+                            delete transport;
+                            exit(1);
+                        }
+                        latency.record(monotonicNanoseconds() - rxTime);
+                        continue;
+                    }
+                    lastCurLapTime = probe.curLapTime;
+                }
+
+                if (framesFile != NULL)
+                {
+                    // Binary frames are recorded as text
+                    if (codec::isBinary(buf, numRead))
+                        fputs(CarState(buf, numRead).toString().c_str(), framesFile);
+                    else
+                        fputs(buf, framesFile);
+                    fputc('\n', framesFile);
+                }
+
                 /**************************************************
                  * Compute The Action to send to the solorace sever
                  **************************************************/
 
+                // The sensors are decoded straight from the receive buffer,
+                // which then receives the action
+                size_t actionLength;
+                bool driven = false;
         if ( (++currentStep) != maxSteps)
         {
-                    string action = d.drive(string(buf));
-                    memset(buf, 0x0, UDP_MSGLEN);
-            sprintf(buf,"%s",action.c_str());
+                    actionLength = d.drive(string_view(buf, numRead), buf, UDP_MSGLEN, rxTime);
+                    driven = true;
         }
         else
-            sprintf (buf, "(meta 1)");
+            actionLength = sprintf (buf, "(meta 1)");
 
-                if (sendto(socketDescriptor, buf, strlen(buf)+1, 0,
-                           (struct sockaddr *) &serverAddress,
-                           sizeof(serverAddress)) < 0)
+                if (!transport->send(buf, actionLength+1))
                 {
                     cerr << "cannot send data ";
-                    CLOSE(socketDescriptor);
+                    delete transport;
                     exit(1);
                 }
+                txTime = monotonicNanoseconds();
+                latency.record(txTime - rxTime);
 #ifdef __UDP_CLIENT_VERBOSE__
-                else
-                    cout << "Sending " << buf << endl;
+                cout << "Sending " << buf << endl;
 #endif
+                if (options.drain)
+                {
+                    memcpy(lastAction, buf, UDP_MSGLEN);
+                    lastActionLength = actionLength;
+                }
+                if (driven)
+                    flightLog.append(rxTime, curEpisode, currentStep, d.input(), d.cc,
+                                     d.fellBack() ? FLIGHT_RECORD_FALLBACK : 0);
             }
             else
             {
                 cout << "** Server did not respond in 1 second.\n";
             }
         }
+        episodeEnd = monotonicNanoseconds();
     } while(shutdownClient==false && ( (++curEpisode) != maxEpisodes) );
 
-    CLOSE(socketDescriptor);
+    identification.report(cout, "Re-identification");
+    if (pipeline != NULL)
+        raceLatency.add(pipeline->totalLatency());
+    raceLatency.report(cout, "Latency recv->send, all episodes");
+
+    delete pipeline;
+    delete transport;
+    if (framesFile != NULL)
+        fclose(framesFile);
+    flightLog.close();
 #ifdef WIN32
     WSACleanup();
 #endif
@@ -304,7 +507,8 @@ int main(int argc, char *argv[])
 //void parse_args(int argc, char *argv[], char *hostName, unsigned int &serverPort, char *id, unsigned int &maxEpisodes,
 //        unsigned int &maxSteps,bool &noise, double &noiseAVG, double &noiseSTD, long &seed, char *trackName, JerryTheRaceCarDriver::tstage &stage)
 void parse_args(int argc, char *argv[], char *hostName, unsigned int &serverPort, char *id, unsigned int &maxEpisodes,
-          unsigned int &maxSteps, char *trackName, JerryTheRaceCarDriver::tstage &stage, bool &train, char* model_path, unsigned int &seed)
+          unsigned int &maxSteps, char *trackName, JerryTheRaceCarDriver::tstage &stage, bool &train, char* model_path, unsigned int &seed,
+          tClientOptions &options)
 {
     int     i;
 
@@ -322,6 +526,17 @@ void parse_args(int argc, char *argv[], char *hostName, unsigned int &serverPort
 //    seed=0;
     strcpy(trackName,"unknown");
     stage=JerryTheRaceCarDriver::UNKNOWN;
+    strcpy(options.framesPath, "");
+    strcpy(options.logPath, "");
+    options.drain = false;
+    options.budget = 0;
+    strcpy(options.transport, "udp");
+    options.binary = false;
+    options.pipeline = false;
+    options.cpu = -1;
+    options.realtime = false;
+    options.fifo = 0;
+    options.predict = -1.0;
 
 
     i = 1;
@@ -386,8 +601,73 @@ void parse_args(int argc, char *argv[], char *hostName, unsigned int &serverPort
             sscanf(argv[i],"seed:%ud", &seed);
             i++;
         }
+        else if (strncmp(argv[i], "frames:", 7) == 0)
+        {
+            sscanf(argv[i],"frames:%s", options.framesPath);
+            i++;
+        }
+        else if (strncmp(argv[i], "log:", 4) == 0)
+        {
+            sscanf(argv[i],"log:%s", options.logPath);
+            i++;
+        }
+        else if (strcmp(argv[i], "drain") == 0)
+        {
+            options.drain = true;
+            i++;
+        }
+        else if (strncmp(argv[i], "transport:", 10) == 0)
+        {
+            sscanf(argv[i],"transport:%s", options.transport);
+            i++;
+        }
+        else if (strcmp(argv[i], "binary") == 0)
+        {
+            options.binary = true;
+            i++;
+        }
+        else if (strcmp(argv[i], "pipeline") == 0)
+        {
+            options.pipeline = true;
+            i++;
+        }
+        else if (strcmp(argv[i], "realtime") == 0)
+        {
+            options.realtime = true;
+            i++;
+        }
+        else if (strcmp(argv[i], "fifo") == 0)
+        {
+            options.fifo = REALTIME_FIFO_PRIORITY;
+            i++;
+        }
+        else if (strncmp(argv[i], "fifo:", 5) == 0)
+        {
+            sscanf(argv[i],"fifo:%d", &options.fifo);
+            i++;
+        }
+        else if (strcmp(argv[i], "predict") == 0)
+        {
+            options.predict = 1.0;
+            i++;
+        }
+        else if (strncmp(argv[i], "predict:", 8) == 0)
+        {
+            sscanf(argv[i],"predict:%lf", &options.predict);
+            i++;
+        }
+        else if (strncmp(argv[i], "cpu:", 4) == 0)
+        {
+            sscanf(argv[i],"cpu:%d", &options.cpu);
+            i++;
+        }
+        else if (strncmp(argv[i], "budget:", 7) == 0)
+        {
+            sscanf(argv[i],"budget:%ld", &options.budget);
+            i++;
+        }
         else {
             i++;        /* ignore bad args */
         }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,133 @@
+/**
+    deadline.cpp
+    Controller running under a per-step compute budget
+
+    @author Antoine Passemiers
+    @version 1.0 09/08/2019
+*/
+
+#include "deadline.h"
+
+
+/**
+    Constructs the deadline-aware controller and starts its worker thread.
+
+    @param controller Controller computing the full car controls.
+    @param budget Time allowed to the controller at each simulation step.
+*/
+DeadlineController::DeadlineController(Controller &controller, std::chrono::microseconds budget) :
+        controller(controller), budget(budget) {
+    // Until a full action is available, the fallback
+    // action keeps the car in first gear without throttle
+    this->last_action = CarControl(0.0, 0.0, 1, 0.0, 0.0, 0, 0);
+    this->worker = std::thread(&DeadlineController::run, this);
+}
+
+/**
+    Stops the worker thread, once the car state
+    being processed (if any) has been handled.
+*/
+DeadlineController::~DeadlineController() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
+    }
+    this->submitted.notify_one();
+    this->worker.join();
+}
+
+/**
+    Main loop of the worker thread: waits for a car state to be
+    submitted and runs the controller on it.
+*/
+void DeadlineController::run() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+        this->submitted.wait(lock, [this] { return this->busy || this->stop; });
+        if (!this->busy) break;
+
+        // The input is not touched by the main thread while busy
+        lock.unlock();
+        CarControl cc = this->controller.control(this->input);
+        lock.lock();
+
+        this->output = cc;
+        this->busy = false;
+        this->ready = true;
+        this->completed.notify_one();
+    }
+}
+
+/**
+    Computes the car controls for the current car state. The controller
+    gets at most the budget, counted from the call, to produce them.
+    Otherwise, or if the controller is still busy with a previous car
+    state, the fallback action is returned and an overrun is counted.
+
+    @param cs Current car state.
+    @return The car controls to be sent to the server.
+*/
+CarControl DeadlineController::control(CarState &cs) {
+    tClock::time_point deadline = tClock::now() + this->budget;
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->n_steps++;
+
+    // A result that came too late is the most recent full action
+    if (this->ready) {
+        this->last_action = this->output;
+        this->ready = false;
+        this->n_late++;
+    }
+
+    if (!this->busy) {
+        this->input = cs;
+        this->busy = true;
+        this->submitted.notify_one();
+        if (this->completed.wait_until(lock, deadline, [this] { return this->ready; })) {
+            this->last_action = this->output;
+            this->ready = false;
+            this->fell_back = false;
+            return this->last_action;
+        }
+    }
+    this->n_overruns++;
+    this->fell_back = true;
+    lock.unlock();
+
+    // Fallback: last full action, steering from the current car state
+    CarControl cc = this->last_action;
+    cc.steer = this->controller.steer(cs);
+    cc.meta = 0;
+    return cc;
+}
+
+/**
+    Waits for the worker to be idle, so that the controller can be
+    safely updated. A pending result becomes the last full action.
+*/
+void DeadlineController::wait() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->completed.wait(lock, [this] { return !this->busy; });
+    if (this->ready) {
+        this->last_action = this->output;
+        this->ready = false;
+        this->n_late++;
+    }
+}
+
+/**
+    Prints the number of steps for which the budget was exceeded,
+    and the number of late results used at a later step (nothing
+    is printed if no step was driven). Statistics are then reset.
+
+    @param os Output stream.
+*/
+void DeadlineController::report(std::ostream &os) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->n_steps == 0) return;
+    os << "Budget overruns: " << this->n_overruns << " / " << this->n_steps << " steps"
+       << " (" << this->budget.count() << " us, late results: " << this->n_late << ")" << std::endl;
+    this->n_steps = 0;
+    this->n_overruns = 0;
+    this->n_late = 0;
+}
@@ -0,0 +1,97 @@
+/**
+    deadline.h
+    Controller running under a per-step compute budget
+
+    @author Antoine Passemiers
+    @version 1.0 09/08/2019
+*/
+
+#ifndef DEADLINE_H__
+#define DEADLINE_H__
+
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "carcontrol.h"
+#include "carstate.h"
+#include "driver.h"
+
+
+/**
+    Runs the controller on a worker thread and waits for it at most
+    a given time budget per simulation step. When the budget is
+    exceeded, a cheap fallback action is returned right away: the last
+    full action, with the steering recomputed by the steering module.
+    The late result becomes the last full action as soon as it is
+    available, so that it is used at the next step.
+*/
+class DeadlineController {
+private:
+    typedef std::chrono::steady_clock tClock;
+
+    // Controller running on the worker thread
+    Controller &controller;
+
+    // Compute budget per simulation step
+    std::chrono::microseconds budget;
+
+    // Worker thread and its synchronization
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable submitted;
+    std::condition_variable completed;
+
+    // Car state being processed by the worker, and its result
+    CarState input;
+    CarControl output;
+
+    // Whether a car state is being processed
+    bool busy = false;
+
+    // Whether the worker has produced a result not yet consumed
+    bool ready = false;
+
+    // Whether the worker has to exit
+    bool stop = false;
+
+    // Last full (non-fallback) action
+    CarControl last_action;
+
+    // Whether the last action returned is a fallback
+    bool fell_back = false;
+
+    // Statistics since the last reset
+    unsigned long n_steps = 0;
+    unsigned long n_overruns = 0;
+    unsigned long n_late = 0;
+
+    // Main loop of the worker thread
+    void run();
+
+public:
+
+    // Constructor and destructor
+    DeadlineController(Controller &controller, std::chrono::microseconds budget);
+    ~DeadlineController();
+
+    // Computes the car controls within the budget
+    CarControl control(CarState &cs);
+
+    // Waits for the worker to be idle
+    void wait();
+
+    // Prints and resets the overrun statistics
+    void report(std::ostream &os);
+
+    // Number of steps for which the budget was exceeded
+    unsigned long overruns() { return this->n_overruns; }
+
+    // Whether the last action returned is a fallback
+    bool fellBack() const { return this->fell_back; }
+};
+
+
+#endif // DEADLINE_H__
@@ -10,21 +10,28 @@
 
 
 /**
-    Constructs the controller, counts the total number of parameters
-    and contructs the particle swarm.
+    Constructs the controller, binds the modules to the parameter
+    buffer and contructs the particle swarm.
 */
-Controller::Controller() {
-    // Compute total number of parameters in the controller
-    this->n_parameters = 0;
-    this->n_parameters += accelbrake_module.getNumberOfParameters();
-    this->n_parameters += gear_module.getNumberOfParameters();
-    this->n_parameters += opponents_module.getNumberOfParameters();
-    this->n_parameters += steering_module.getNumberOfParameters();
-    this->n_parameters += target_speed_module.getNumberOfParameters();
+template <typename T>
+BasicController<T>::BasicController() {
+    // Modules read their parameters from consecutive slices of a single
+    // buffer, at offsets known at compile time. Each slice is initialized
+    // with the current parameters of its module, and the bounds on them
+    // are stored
+    this->lower_bounds = Eigen::VectorXd::Zero(N_PARAMETERS);
+    this->upper_bounds = Eigen::VectorXd::Zero(N_PARAMETERS);
+    this->modules.forEach([this](auto &module, auto offset) {
+        constexpr size_t n = std::decay_t<decltype(module)>::N_PARAMETERS;
+        this->parameters.template segment<n>(offset) = module.getParameters();
+        this->lower_bounds.template segment<n>(offset) = module.getLowerBounds().template cast<double>();
+        this->upper_bounds.template segment<n>(offset) = module.getUpperBounds().template cast<double>();
+        module.bind(this->parameters.data() + offset);
+    });
 
     // Initialize a PSO with 50 particles and specified
     // values for the hyper-parameters
-    this->pso = new PSO(MAXIMIZE, 50, this->n_parameters);
+    this->pso = new PSO(MAXIMIZE, 50, N_PARAMETERS);
     this->pso->setPhi1(1.87);
     this->pso->setPhi2(1.24);
     this->pso->setInertia(0.85);
@@ -38,7 +45,8 @@ Controller::Controller() {
 
     @return Whether the training process has stopped.
 */
-bool Controller::finishedLearning() {
+template <typename T>
+bool BasicController<T>::finishedLearning() {
     if (this->is_training) {
         bool finished = this->pso->terminationCondition();
         if (finished) {
@@ -57,7 +65,8 @@ bool Controller::finishedLearning() {
 
     @param is_training Whether the training mode is on.
 */
-void Controller::train(bool is_training) {
+template <typename T>
+void BasicController<T>::train(bool is_training) {
     this->is_training = is_training;
     if (!is_training) {
         this->loadModel();
@@ -70,14 +79,16 @@ void Controller::train(bool is_training) {
     @param model_path Path to the file used for
         storing/loading controller parameters.
 */
-void Controller::setModelLocation(std::string model_path) {
+template <typename T>
+void BasicController<T>::setModelLocation(std::string model_path) {
     this->model_path = model_path;
 }
 
 /**
     Saves controller parameters to file.
 */
-void Controller::saveModel() {
+template <typename T>
+void BasicController<T>::saveModel() {
     // Get best particle position
     Eigen::VectorXd parameters = this->pso->getBestPosition();
 
@@ -96,7 +107,8 @@ void Controller::saveModel() {
 /**
     Loads controller parameters from file.
 */
-void Controller::loadModel() {
+template <typename T>
+void BasicController<T>::loadModel() {
     // Allocate space for storing parameters
     size_t n = this->pso->n_dim;
     Eigen::VectorXd parameters = Eigen::VectorXd::Zero(n);
@@ -120,7 +132,8 @@ void Controller::loadModel() {
 /**
     Initializes the controller and particle swarm optimizer.
 */
-void Controller::initialize() {
+template <typename T>
+void BasicController<T>::initialize() {
     // Initializes empty history of evaluations of
     // the objective function
     this->objective = std::vector<double>();
@@ -153,18 +166,23 @@ void Controller::initialize() {
     @param cs Current car state.
     @return Car controls.
 */
-CarControl Controller::control(CarState &cs) {
+template <typename T>
+CarControl BasicController<T>::control(CarState &cs) {
     CarControl cc;
     cc.clutch = 0.0; // Clutch is not considered in the model
 
+    // Quantities derived from the sensors, shared by the modules
+    CarFeatures<T> features;
+    features.compute(cs);
+
     // Get module outputs based on sensory data
-    int gear = this->gear_module.control(cs);
-    double target_speed = this->target_speed_module.control(cs);
-    double accelbrake = this->accelbrake_module.control(cs, target_speed);
-    double steer = this->steering_module.control(cs);
+    int gear = this->modules.template get<GearModule<T>>().control(cs);
+    T target_speed = this->modules.template get<TargetSpeedModule<T>>().control(cs, features);
+    T accelbrake = this->modules.template get<AccelBrakeModule<T>>().control(cs, features, target_speed);
+    T steer = this->modules.template get<SteeringControlModule<T>>().control(cs, features);
 
     // Apply adjustments on the outputs based on opponent sensors
-    this->opponents_module.control(cs, steer, accelbrake);
+    this->modules.template get<OpponentsModule<T>>().control(cs, features, steer, accelbrake);
 
     // Acceleration and brake are set by the same control variable
     // to avoid nonsense outputs
@@ -181,12 +199,39 @@ CarControl Controller::control(CarState &cs) {
     return cc;
 }
 
+/**
+    Forgets the state the modules keep from one step to the next
+    (whether the car is stuck), as if no step had been driven.
+*/
+template <typename T>
+void BasicController<T>::reset() {
+    this->modules.template get<GearModule<T>>().reset();
+}
+
+/**
+    Computes the steering value alone, without the other modules
+    nor the adjustments based on opponent sensors. This is a cheap
+    reflex for when the full controls cannot be computed in time.
+
+    @param cs Current car state.
+    @return Steering value.
+*/
+template <typename T>
+T BasicController<T>::steer(CarState &cs) {
+    // The features are not shared with control, which may run
+    // concurrently on another thread
+    CarFeatures<T> features;
+    features.compute(cs);
+    return this->modules.template get<SteeringControlModule<T>>().control(cs, features);
+}
+
 /**
     Updates the controller and the particle swarm optimizer.
 
     @param objective Evaluation of the objective function.
 */
-void Controller::update(double objective) {
+template <typename T>
+void BasicController<T>::update(double objective) {
     this->objective.push_back(objective);
 
     // Display the history of evaluations of the objective function
@@ -218,142 +263,44 @@ void Controller::update(double objective) {
 }
 
 /**
-    Concatenates lowerbounds of modules parameters
-    and returns them as a single vector.
-
-    @return Lower bounds on the modules parameters.
+    @return Lower bounds on the modules parameters,
+        concatenated in a single vector.
 */
-Eigen::VectorXd Controller::getLowerBounds() {
-    // Get lower bounds of accelbrake module parameters
-    Eigen::VectorXd lbs = Eigen::VectorXd::Zero(this->n_parameters);
-    int j = 0;
-    int n = this->accelbrake_module.getNumberOfParameters();
-    lbs.segment(j, n) = this->accelbrake_module.getLowerBounds();
-
-    // Get lower bounds of gear selection module parameters
-    j += n;
-    n = this->gear_module.getNumberOfParameters();
-    lbs.segment(j, n) = this->gear_module.getLowerBounds();
-
-    // Get lower bounds of opponents module parameters
-    j += n;
-    n = this->opponents_module.getNumberOfParameters();
-    lbs.segment(j, n) = this->opponents_module.getLowerBounds();
-
-    // Get lower bounds of steering module parameters
-    j += n;
-    n = this->steering_module.getNumberOfParameters();
-    lbs.segment(j, n) = this->steering_module.getLowerBounds();
-
-    // Get lower bounds of target speed module parameters
-    j += n;
-    n = this->target_speed_module.getNumberOfParameters();
-    lbs.segment(j, n) = this->target_speed_module.getLowerBounds();
-    return lbs;
+template <typename T>
+const Eigen::VectorXd& BasicController<T>::getLowerBounds() {
+    return this->lower_bounds;
 }
 
 /**
-    Concatenates upper bounds of modules parameters
-    and returns them as a single vector.
-
-    @return Upper bounds on the modules parameters.
+    @return Upper bounds on the modules parameters,
+        concatenated in a single vector.
 */
-Eigen::VectorXd Controller::getUpperBounds() {
-    // Get upper bounds of accelbrake module parameters
-    Eigen::VectorXd ubs = Eigen::VectorXd::Zero(this->n_parameters);
-    int j = 0;
-    int n = this->accelbrake_module.getNumberOfParameters();
-    ubs.segment(j, n) = this->accelbrake_module.getUpperBounds();
-
-    // Get upper bounds of gear selection module parameters
-    j += n;
-    n = this->gear_module.getNumberOfParameters();
-    ubs.segment(j, n) = this->gear_module.getUpperBounds();
-
-    // Get upper bounds of opponents module parameters
-    j += n;
-    n = this->opponents_module.getNumberOfParameters();
-    ubs.segment(j, n) = this->opponents_module.getUpperBounds();
-
-    // Get upper bounds of steering module parameters
-    j += n;
-    n = this->steering_module.getNumberOfParameters();
-    ubs.segment(j, n) = this->steering_module.getUpperBounds();
-
-    // Get upper bounds of target speed module parameters
-    j += n;
-    n = this->target_speed_module.getNumberOfParameters();
-    ubs.segment(j, n) = this->target_speed_module.getUpperBounds();
-    return ubs;
+template <typename T>
+const Eigen::VectorXd& BasicController<T>::getUpperBounds() {
+    return this->upper_bounds;
 }
 
 /**
-    Concatenates modules parameters and return them
-    as a single vector.
-
-    @return Current values of modules parameters.
+    @return Current values of modules parameters,
+        concatenated in a single vector.
 */
-Eigen::VectorXd Controller::getParameters() {
-    // Get accebrake module parameters
-    Eigen::VectorXd parameters = Eigen::VectorXd::Zero(this->n_parameters);
-    int j = 0;
-    int n = this->accelbrake_module.getNumberOfParameters();
-    parameters.segment(j, n) = this->accelbrake_module.getParameters();
-
-    // Get gear module parameters
-    j += n;
-    n = this->gear_module.getNumberOfParameters();
-    parameters.segment(j, n) = this->gear_module.getParameters();
-
-    // Get opponents module parameters
-    j += n;
-    n = this->opponents_module.getNumberOfParameters();
-    parameters.segment(j, n) = this->opponents_module.getParameters();
-
-    // Get steering module parameters
-    j += n;
-    n = this->steering_module.getNumberOfParameters();
-    parameters.segment(j, n) = this->steering_module.getParameters();
-
-    // Get target speed module parameters
-    j += n;
-    n = this->target_speed_module.getNumberOfParameters();
-    parameters.segment(j, n) = this->target_speed_module.getParameters();
-    return parameters;
+template <typename T>
+Eigen::VectorXd BasicController<T>::getParameters() {
+    return this->parameters.template cast<double>();
 }
 
 /**
-    Sets current values of modules parameters.
+    Sets current values of modules parameters, with a single copy
+    into the parameter buffer the modules read.
 
     @param Current values of modules parameters,
         stored as a single vector.
 */
-void Controller::setParameters(Eigen::VectorXd &parameters) {
-    // Set accelbrake module parameters
-    int j = 0;
-    int n = this->accelbrake_module.getNumberOfParameters();
-    Eigen::VectorXd segment = parameters.segment(j, n);
-    this->accelbrake_module.setParameters(segment);
-    j += n;
-    n = this->gear_module.getNumberOfParameters();
-    segment = parameters.segment(j, n);
-    this->gear_module.setParameters(segment);
-
-    // Set opponents module parameters
-    j += n;
-    n = this->opponents_module.getNumberOfParameters();
-    segment = parameters.segment(j, n);
-    this->opponents_module.setParameters(segment);
-
-    // Set steering module parameters
-    j += n;
-    n = this->steering_module.getNumberOfParameters();
-    segment = parameters.segment(j, n);
-    this->steering_module.setParameters(segment);
-
-    // Set target speed module parameters
-    j += n;
-    n = this->target_speed_module.getNumberOfParameters();
-    segment = parameters.segment(j, n);
-    this->target_speed_module.setParameters(segment);
+template <typename T>
+void BasicController<T>::setParameters(const Eigen::VectorXd &parameters) {
+    assert(static_cast<size_t>(parameters.size()) == N_PARAMETERS);
+    this->parameters = parameters.template cast<T>();
 }
+
+template class BasicController<float>;
+template class BasicController<double>;
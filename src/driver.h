@@ -10,6 +10,7 @@
 #define DRIVER_H__
 
 #include <Eigen/Core>
+#include <cassert>
 #include <cmath>
 #include <fstream>
 #include <iostream>
@@ -19,8 +20,10 @@
 #include "accelbrake.h"
 #include "carcontrol.h"
 #include "carstate.h"
+#include "carfeatures.h"
 #include "gear.h"
 #include "mlp.h"
+#include "module.h"
 #include "opponents.h"
 #include "particle.h"
 #include "pso.h"
@@ -28,7 +31,15 @@
 #include "steering.h"
 
 
-class Controller {
+/**
+    Driving controller, made of the driving modules and of the particle
+    swarm optimizer training them. The modules compute with the scalar
+    type T; the optimizer and the model files stay in double precision.
+
+    @param T Scalar type of the modules.
+*/
+template <typename T>
+class BasicController {
 private:
 
     // Whether to train the driver using a PSO
@@ -46,21 +57,33 @@ private:
     // History of the objective function
     std::vector<double> objective;
 
-    // Modules
-    GearModule gear_module;
-    TargetSpeedModule target_speed_module;
-    AccelBrakeModule accelbrake_module;
-    SteeringControlModule steering_module;
-    OpponentsModule opponents_module;
+    // Modules, with their parameters laid out in this order
+    typedef ModuleChain<AccelBrakeModule<T>, GearModule<T>, OpponentsModule<T>,
+        SteeringControlModule<T>, TargetSpeedModule<T>> tModules;
+    tModules modules;
 
-    // Number of parameters
-    size_t n_parameters;
+    // Parameters of all the modules, in a single buffer. Each module
+    // reads its own slice of it, so that switching to another particle
+    // is a single copy
+    Eigen::Matrix<T, tModules::N_PARAMETERS, 1> parameters;
+
+    // Bounds on the parameters, computed once
+    Eigen::VectorXd lower_bounds;
+    Eigen::VectorXd upper_bounds;
 
 public:
 
+    // Sensors read by the modules
+    static constexpr unsigned int SENSORS = tModules::SENSORS;
+
+    // Total number of parameters
+    static constexpr size_t N_PARAMETERS = tModules::N_PARAMETERS;
+
     // Constructor and destructor
-    Controller();
-    ~Controller() = default;
+    BasicController();
+    BasicController(const BasicController &) = delete;
+    BasicController& operator=(const BasicController &) = delete;
+    ~BasicController() = default;
 
     // File-related methods
     void setModelLocation(std::string model_path);
@@ -76,12 +99,21 @@ public:
     void update(double objective);
     CarControl control(CarState &cs);
 
+    // Forgets the state the modules keep from one step to the next
+    void reset();
+
+    // Steering alone, as a cheap reflex
+    T steer(CarState &cs);
+
     // Getters / setters
-    Eigen::VectorXd getLowerBounds();
-    Eigen::VectorXd getUpperBounds();
+    const Eigen::VectorXd& getLowerBounds();
+    const Eigen::VectorXd& getUpperBounds();
     Eigen::VectorXd getParameters();
-    void setParameters(Eigen::VectorXd &parameters);
+    void setParameters(const Eigen::VectorXd &parameters);
 };
 
+// Controller of the client, in the scalar type of the build
+typedef BasicController<tScalar> Controller;
+
 
 #endif // CONTROLLER_H__
@@ -0,0 +1,362 @@
+/**
+    fixedmlp.h
+    Multi-layer perceptrons with a topology fixed at compile time
+
+    @author Antoine Passemiers
+    @version 1.0 16/08/2019
+*/
+
+#ifndef FIXEDMLP_H__
+#define FIXEDMLP_H__
+
+#include <Eigen/Core>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+#include "activations.h"
+#include "utils.h"
+
+
+// Activation functions, applied in place to the outputs of a layer,
+// either a vector or a matrix holding a batch of outputs (tanh and
+// sigmoid are approximated if built with ACTIVATIONS=approx)
+struct Identity {
+    template <typename Matrix>
+    static void apply(Matrix &) {}
+};
+
+struct Sigmoid {
+    template <typename Matrix>
+    static void apply(Matrix &X) {
+        typedef typename Matrix::Scalar T;
+        T* data = X.data();
+#ifdef __APPROX_ACTIVATIONS__
+        approxSigmoid(data, X.size());
+#else
+        for (Eigen::Index i = 0; i < X.size(); i++) data[i] = T(1) / (T(1) + std::exp(-data[i]));
+#endif
+    }
+};
+
+struct Tanh {
+    template <typename Matrix>
+    static void apply(Matrix &X) {
+        typedef typename Matrix::Scalar T;
+        T* data = X.data();
+#ifdef __APPROX_ACTIVATIONS__
+        approxTanh(data, X.size());
+#else
+        for (Eigen::Index i = 0; i < X.size(); i++) data[i] = std::tanh(data[i]);
+#endif
+    }
+};
+
+struct ReLU {
+    template <typename Matrix>
+    static void apply(Matrix &X) {
+        typedef typename Matrix::Scalar T;
+        T* data = X.data();
+        for (Eigen::Index i = 0; i < X.size(); i++) data[i] = std::max(T(0), data[i]);
+    }
+};
+
+// Ensures that the values stay in the range [0, 1]
+struct Clipping {
+    template <typename Matrix>
+    static void apply(Matrix &X) {
+        typedef typename Matrix::Scalar T;
+        T* data = X.data();
+        for (Eigen::Index i = 0; i < X.size(); i++) data[i] = std::max(T(0), std::min(T(1), data[i] + T(0.5)));
+    }
+};
+
+
+/**
+    Fully-connected layer with biases, followed by an activation function.
+    The layer stores its outputs only: its parameters are read from the
+    concatenated parameters of the network.
+
+    @param N_IN Number of input neurons.
+    @param N_OUT Number of output neurons.
+    @param Activation Activation function.
+    @param T Scalar type of the parameters and outputs.
+*/
+template <int N_IN, int N_OUT, typename Activation = Identity, typename T = double>
+struct Dense {
+    typedef T Scalar;
+    static constexpr int N_INPUTS = N_IN;
+    static constexpr int N_OUTPUTS = N_OUT;
+    static constexpr size_t N_PARAMETERS = N_IN * N_OUT + N_OUT;
+
+    // Weights are stored row by row, followed by the biases
+    typedef Eigen::Matrix<T, N_IN, N_OUT, (N_OUT == 1) ? Eigen::ColMajor : Eigen::RowMajor> tWeights;
+    typedef Eigen::Matrix<T, N_OUT, 1> tOutput;
+    typedef Eigen::Matrix<T, N_OUT, Eigen::Dynamic> tOutputBatch;
+    typedef Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> tMatrix;
+
+    // Views over the weights and biases of the layer, given its parameters
+    static Eigen::Map<const tWeights> weights(const T* p) { return Eigen::Map<const tWeights>(p); }
+    static Eigen::Map<const tOutput> biases(const T* p) { return Eigen::Map<const tOutput>(p + N_IN * N_OUT); }
+
+    // Outputs of the layer
+    tOutput h = tOutput::Zero();
+
+    template <typename Input>
+    void forward(const T* p, const Input &x) {
+        this->h.noalias() = weights(p).transpose() * x;
+        this->h += biases(p);
+        Activation::apply(this->h);
+    }
+
+    /**
+        Outputs of the layer for a batch of inputs, with a single
+        matrix product.
+
+        @param p Parameters of the layer.
+        @param X Inputs, one per column.
+        @return Outputs, one per column.
+    */
+    template <typename Input>
+    static tOutputBatch forwardBatch(const T* p, const Input &X) {
+        tOutputBatch H(N_OUT, X.cols());
+        H.noalias() = weights(p).transpose() * X;
+        H.colwise() += biases(p);
+        Activation::apply(H);
+        return H;
+    }
+
+    /**
+        Outputs of K layers of this type, whose parameters are stacked
+        in the columns of a matrix. If the K layers share their inputs
+        (first layer of K networks), their weights are stacked as well
+        and multiplied with the inputs at once. Otherwise, the k-th layer
+        reads the k-th block of N_IN rows of the inputs.
+
+        @param P Parameters of the networks, one network per column.
+        @param offset Row of P where the parameters of the layers start.
+        @param X Inputs, one per column.
+        @param shared Whether the K layers read the same inputs.
+        @return Outputs, in K blocks of N_OUT rows.
+    */
+    template <typename Input>
+    static tMatrix forwardStacked(const Eigen::Ref<const tMatrix> &P, Eigen::Index offset, const Input &X, bool shared) {
+        Eigen::Index K = P.cols();
+        tMatrix H(K * N_OUT, X.cols());
+        if (shared) {
+            tMatrix W(K * N_OUT, N_IN);
+            tMatrix B(K * N_OUT, 1);
+            for (Eigen::Index k = 0; k < K; k++) {
+                const T* p = P.col(k).data() + offset;
+                W.middleRows(k * N_OUT, N_OUT) = weights(p).transpose();
+                B.middleRows(k * N_OUT, N_OUT) = biases(p);
+            }
+            H.noalias() = W * X;
+            H.colwise() += B.col(0);
+        } else {
+            for (Eigen::Index k = 0; k < K; k++) {
+                const T* p = P.col(k).data() + offset;
+                auto Hk = H.middleRows(k * N_OUT, N_OUT);
+                Hk.noalias() = weights(p).transpose() * X.middleRows(k * N_IN, N_IN);
+                Hk.colwise() += biases(p);
+            }
+        }
+        Activation::apply(H);
+        return H;
+    }
+};
+
+
+/**
+    Multi-layer perceptron whose layers are known at compile time,
+    e.g. FixedMLP<Dense<7, 7, Tanh>, Dense<7, 1, Clipping>>. All the
+    vectors and matrices have fixed sizes and live in the network
+    itself: the forward pass is unrolled and allocates nothing. The
+    parameters are stored in the network, or read from a buffer
+    owned by someone else (see bind).
+    Parameters are concatenated in the same order as for MLP. The
+    scalar type is the one of the layers, e.g. Dense<7, 1, Clipping, float>.
+
+    @param Layers Dense layers, in order.
+*/
+template <typename... Layers>
+class FixedMLP {
+private:
+    static constexpr size_t N_LAYERS = sizeof...(Layers);
+    static_assert(N_LAYERS > 0, "A network needs at least one layer");
+
+    typedef std::tuple<Layers...> tLayers;
+    typedef typename std::tuple_element<0, tLayers>::type tFirst;
+    typedef typename std::tuple_element<N_LAYERS - 1, tLayers>::type tLast;
+    static_assert((std::is_same<typename Layers::Scalar, typename tFirst::Scalar>::value && ...),
+        "All the layers must have the same scalar type");
+
+    // Network inputs
+    typedef Eigen::Matrix<typename tFirst::Scalar, tFirst::N_INPUTS, 1> tInput;
+    tInput x = tInput::Zero();
+
+    // Layers, each storing its outputs
+    tLayers layers;
+
+    // Parameters stored in the network, and external parameters if bound
+    Eigen::Matrix<typename tFirst::Scalar, (Layers::N_PARAMETERS + ...), 1> storage =
+        Eigen::Matrix<typename tFirst::Scalar, (Layers::N_PARAMETERS + ...), 1>::Zero();
+    const typename tFirst::Scalar* external = nullptr;
+
+    // Parameters in use
+    const typename tFirst::Scalar* parameters() const {
+        return (this->external != nullptr) ? this->external : this->storage.data();
+    }
+
+    // Row of the concatenated parameters where layer K starts
+    template <size_t K>
+    static constexpr size_t parameterOffset() {
+        if constexpr (K == 0) return 0;
+        else return parameterOffset<K - 1>() + std::tuple_element<K - 1, tLayers>::type::N_PARAMETERS;
+    }
+
+    // Forward pass from layer K to the last one
+    template <size_t K>
+    void forwardFrom() {
+        typedef typename std::tuple_element<K, tLayers>::type tLayer;
+        const typename tFirst::Scalar* p = this->parameters() + parameterOffset<K>();
+        if constexpr (K == 0) {
+            std::get<0>(this->layers).forward(p, this->x);
+        } else {
+            typedef typename std::tuple_element<K - 1, tLayers>::type tPrevious;
+            static_assert(tPrevious::N_OUTPUTS == tLayer::N_INPUTS, "Consecutive layers must have matching sizes");
+            std::get<K>(this->layers).forward(p, std::get<K - 1>(this->layers).h);
+        }
+        if constexpr (K + 1 < N_LAYERS) this->forwardFrom<K + 1>();
+    }
+
+    // Batched forward pass from layer K to the last one
+    template <size_t K, typename Input, typename Output>
+    void forwardBatchFrom(const Input &X, Output &Y) const {
+        typedef typename std::tuple_element<K, tLayers>::type tLayer;
+        auto H = tLayer::forwardBatch(this->parameters() + parameterOffset<K>(), X);
+        if constexpr (K + 1 < N_LAYERS) this->forwardBatchFrom<K + 1>(H, Y);
+        else Y = std::move(H);
+    }
+
+    // Forward pass of K stacked networks from layer L to the last one
+    template <size_t L, typename Parameters, typename Input, typename Output>
+    static void forwardStackedFrom(const Parameters &P, const Input &X, Output &Y) {
+        typedef typename std::tuple_element<L, tLayers>::type tLayer;
+        auto H = tLayer::forwardStacked(P, parameterOffset<L>(), X, L == 0);
+        if constexpr (L + 1 < N_LAYERS) forwardStackedFrom<L + 1>(P, H, Y);
+        else Y = std::move(H);
+    }
+
+public:
+    typedef typename tFirst::Scalar Scalar;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> tVector;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> tMatrix;
+
+    // Batches of inputs and outputs, one per column
+    typedef Eigen::Matrix<Scalar, tFirst::N_INPUTS, Eigen::Dynamic> tInputBatch;
+    typedef Eigen::Matrix<Scalar, tLast::N_OUTPUTS, Eigen::Dynamic> tOutputBatch;
+
+    static constexpr int N_INPUTS = tFirst::N_INPUTS;
+    static constexpr int N_OUTPUTS = tLast::N_OUTPUTS;
+
+    // Number of parameters in the network
+    static constexpr size_t N_PARAMETERS = (Layers::N_PARAMETERS + ...);
+
+    // Network input and output
+    Scalar& in(int i) { return this->x[i]; }
+    Scalar out(int i) const { return std::get<N_LAYERS - 1>(this->layers).h[i]; }
+    const typename tLast::tOutput& out() const { return std::get<N_LAYERS - 1>(this->layers).h; }
+
+    size_t getNumberOfParameters() const { return N_PARAMETERS; }
+
+    /**
+        Initializes parameters values (Xavier initialization for the
+        weights, Gaussian biases as in MLP::initWeights).
+    */
+    void initWeights() {
+        size_t offset = 0;
+        ((this->storage.segment(offset, Layers::N_INPUTS * Layers::N_OUTPUTS) =
+              randGaussian(Layers::N_INPUTS * Layers::N_OUTPUTS, 0.0,
+                  std::sqrt(2.0 / (Layers::N_INPUTS + Layers::N_OUTPUTS))).template cast<Scalar>(),
+          this->storage.segment(offset + Layers::N_INPUTS * Layers::N_OUTPUTS, Layers::N_OUTPUTS) =
+              randGaussian(Layers::N_OUTPUTS, 0.0, std::sqrt(1.0 / Layers::N_OUTPUTS)).template cast<Scalar>(),
+          offset += Layers::N_PARAMETERS), ...);
+        this->external = nullptr;
+    }
+
+    /**
+        Sets the parameters values, which are copied into the network
+        (which then stops reading external parameters).
+
+        @param weights Parameter values, provided as a single vector.
+    */
+    void setWeights(const tVector &weights) {
+        assert(static_cast<size_t>(weights.size()) == N_PARAMETERS);
+        this->storage = weights;
+        this->external = nullptr;
+    }
+
+    /**
+        Makes the network read its parameters from the given buffer,
+        without copying them. The buffer must outlive the network.
+
+        @param weights First of the N_PARAMETERS values, in the order
+            of setWeights.
+    */
+    void bind(const Scalar* weights) {
+        this->external = weights;
+    }
+
+    /**
+        Gets the concatenation of all network parameters.
+
+        @return Network parameters.
+    */
+    tVector getWeights() const {
+        return Eigen::Map<const tVector>(this->parameters(), N_PARAMETERS);
+    }
+
+    /**
+        Computes the outputs of the network based on the input values.
+    */
+    void forward() {
+        this->forwardFrom<0>();
+    }
+
+    /**
+        Computes the outputs of the network for a batch of inputs.
+        Each layer is a single matrix product over the whole batch,
+        rather than one matrix-vector product per input.
+
+        @param X Inputs, one per column.
+        @param Y Outputs, one per column (resized).
+    */
+    void forwardBatch(const tInputBatch &X, tOutputBatch &Y) const {
+        this->forwardBatchFrom<0>(X, Y);
+    }
+
+    /**
+        Computes the outputs of K networks of this topology for a batch
+        of inputs, e.g. to evaluate a whole swarm on recorded states.
+        The parameters of the networks are stacked in the columns of a
+        matrix, each in the order of setWeights. The first layers of
+        the K networks are evaluated with a single matrix product, the
+        next ones with one matrix product per network.
+
+        @param P Parameters, one network per column (N_PARAMETERS rows).
+        @param X Inputs, one per column.
+        @param Y Outputs (resized): the outputs of network k are
+            in rows k * N_OUTPUTS to (k + 1) * N_OUTPUTS - 1.
+    */
+    static void forwardStacked(const Eigen::Ref<const tMatrix> &P, const tInputBatch &X, tMatrix &Y) {
+        assert(static_cast<size_t>(P.rows()) >= N_PARAMETERS);
+        forwardStackedFrom<0>(P, X, Y);
+    }
+};
+
+
+#endif // FIXEDMLP_H__
@@ -0,0 +1,191 @@
+/**
+    flightlog.cpp
+    Binary log of the car states and car controls of a race
+
+    @author Antoine Passemiers
+    @version 1.0 11/08/2019
+*/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "flightlog.h"
+
+
+static const char FLIGHT_LOG_MAGIC[8] = { 'S', 'C', 'R', 'L', 'O', 'G', '\0', '\0' };
+
+
+/**
+    Closes the log if it is still open.
+*/
+FlightLog::~FlightLog() {
+    this->close();
+}
+
+/**
+    Grows the file and maps it with room for a given number of records.
+
+    @param capacity Number of records.
+    @return Whether the file could be mapped.
+*/
+bool FlightLog::map(size_t capacity) {
+    size_t length = sizeof(FlightLogHeader) + capacity * sizeof(FlightRecord);
+    if (this->data != nullptr) {
+        munmap(this->data, sizeof(FlightLogHeader) + this->capacity * sizeof(FlightRecord));
+        this->data = nullptr;
+    }
+    if (ftruncate(this->fd, length) < 0) return false;
+    void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+    if (ptr == MAP_FAILED) return false;
+    this->data = static_cast<char*>(ptr);
+    this->capacity = capacity;
+    return true;
+}
+
+/**
+    Creates the log file, truncating any existing one.
+
+    @param path Location of the log file.
+    @return Whether the file could be created.
+*/
+bool FlightLog::open(const std::string &path) {
+    this->close();
+    this->fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (this->fd < 0) return false;
+    if (!this->map(CHUNK_RECORDS)) {
+        this->close();
+        return false;
+    }
+    FlightLogHeader* header = reinterpret_cast<FlightLogHeader*>(this->data);
+    std::memcpy(header->magic, FLIGHT_LOG_MAGIC, sizeof(header->magic));
+    header->version = FLIGHT_LOG_VERSION;
+    header->record_size = sizeof(FlightRecord);
+    header->n_records = 0;
+    return true;
+}
+
+/**
+    Appends a simulation step to the log. The record is written
+    before the record count is updated, so that the file stays
+    readable if the process dies. Nothing happens if the log is closed.
+
+    @param timestamp Arrival time of the sensors.
+    @param episode Episode number.
+    @param step Simulation step within the episode.
+    @param cs Car state given to the controller.
+    @param cc Car controls sent to the server.
+    @param flags FLIGHT_RECORD_* flags.
+*/
+void FlightLog::append(int64_t timestamp, uint32_t episode, uint32_t step, const CarState &cs, const CarControl &cc,
+                       uint32_t flags) {
+    if (this->data == nullptr) return;
+    size_t n = reinterpret_cast<FlightLogHeader*>(this->data)->n_records;
+    if ((n == this->capacity) && !this->map(this->capacity + CHUNK_RECORDS)) {
+        this->close();
+        return;
+    }
+    FlightRecord* record = reinterpret_cast<FlightRecord*>(this->data + sizeof(FlightLogHeader)) + n;
+    record->timestamp = timestamp;
+    record->episode = episode;
+    record->step = step;
+    record->flags = flags;
+    record->state = cs;
+    record->action = cc;
+    reinterpret_cast<FlightLogHeader*>(this->data)->n_records = n + 1;
+}
+
+/**
+    @return Number of records written.
+*/
+size_t FlightLog::size() const {
+    if (this->data == nullptr) return 0;
+    return reinterpret_cast<const FlightLogHeader*>(this->data)->n_records;
+}
+
+/**
+    Trims the file to the records actually written and closes it.
+*/
+void FlightLog::close() {
+    if (this->data != nullptr) {
+        size_t n = this->size();
+        munmap(this->data, sizeof(FlightLogHeader) + this->capacity * sizeof(FlightRecord));
+        this->data = nullptr;
+        if (ftruncate(this->fd, sizeof(FlightLogHeader) + n * sizeof(FlightRecord)) < 0) {
+            std::cerr << "Cannot trim flight log" << std::endl;
+        }
+    }
+    if (this->fd >= 0) {
+        ::close(this->fd);
+        this->fd = -1;
+    }
+    this->capacity = 0;
+}
+
+
+/**
+    Unmaps the log if it is still mapped.
+*/
+FlightLogReader::~FlightLogReader() {
+    this->close();
+}
+
+/**
+    Maps a log file in memory and checks that its
+    records have the layout of this build.
+
+    @param path Location of the log file.
+    @return Whether the log could be read.
+*/
+bool FlightLogReader::open(const std::string &path) {
+    this->close();
+    this->fd = ::open(path.c_str(), O_RDONLY);
+    if (this->fd < 0) return false;
+
+    struct stat st;
+    if ((fstat(this->fd, &st) < 0) || (static_cast<size_t>(st.st_size) < sizeof(FlightLogHeader))) {
+        this->close();
+        return false;
+    }
+    this->length = st.st_size;
+    void* ptr = mmap(nullptr, this->length, PROT_READ, MAP_SHARED, this->fd, 0);
+    if (ptr == MAP_FAILED) {
+        this->close();
+        return false;
+    }
+    this->data = static_cast<char*>(ptr);
+
+    const FlightLogHeader* header = reinterpret_cast<const FlightLogHeader*>(this->data);
+    if ((std::memcmp(header->magic, FLIGHT_LOG_MAGIC, sizeof(header->magic)) != 0)
+            || (header->version != FLIGHT_LOG_VERSION) || (header->record_size != sizeof(FlightRecord))
+            || (header->n_records > (this->length - sizeof(FlightLogHeader)) / sizeof(FlightRecord))) {
+        this->close();
+        return false;
+    }
+    this->n_records = header->n_records;
+    return true;
+}
+
+/**
+    @return First record of the log.
+*/
+const FlightRecord* FlightLogReader::records() const {
+    return reinterpret_cast<const FlightRecord*>(this->data + sizeof(FlightLogHeader));
+}
+
+/**
+    Unmaps and closes the log file.
+*/
+void FlightLogReader::close() {
+    if (this->data != nullptr) {
+        munmap(this->data, this->length);
+        this->data = nullptr;
+    }
+    if (this->fd >= 0) {
+        ::close(this->fd);
+        this->fd = -1;
+    }
+    this->length = 0;
+    this->n_records = 0;
+}
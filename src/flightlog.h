@@ -0,0 +1,131 @@
+/**
+    flightlog.h
+    Binary log of the car states and car controls of a race
+
+    @author Antoine Passemiers
+    @version 1.0 11/08/2019
+*/
+
+#ifndef FLIGHTLOG_H__
+#define FLIGHTLOG_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include "carcontrol.h"
+#include "carstate.h"
+
+
+// Version of the record layout
+#define FLIGHT_LOG_VERSION 2
+
+// Flags of a record: the action is the fallback sent when the compute
+// budget was exceeded, not the output of the controller
+#define FLIGHT_RECORD_FALLBACK 1
+
+
+// One simulation step: car state given to the controller (decoded,
+// or extrapolated) and car controls sent back
+struct FlightRecord {
+    // Arrival time of the sensors on the monotonic clock, in nanoseconds
+    int64_t timestamp;
+
+    // Episode and simulation step within the episode
+    uint32_t episode;
+    uint32_t step;
+
+    // FLIGHT_RECORD_* flags
+    uint32_t flags;
+
+    CarState state;
+    CarControl action;
+};
+
+static_assert(std::is_trivially_copyable<FlightRecord>::value, "Flight records are copied as raw bytes");
+
+
+// Header at the beginning of a log file
+struct FlightLogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t n_records;
+};
+
+
+/**
+    Append-only log of fixed-size records, written through a memory
+    mapping of the file. The mapping grows by large chunks, so that
+    appending a record is a plain copy in memory.
+*/
+class FlightLog {
+private:
+    // Number of records by which the file grows
+    static constexpr size_t CHUNK_RECORDS = 65536;
+
+    // File descriptor (-1 if closed)
+    int fd = -1;
+
+    // Mapped file, header followed by records
+    char* data = nullptr;
+
+    // Capacity of the mapping, in records
+    size_t capacity = 0;
+
+    // Maps the file with room for a given number of records
+    bool map(size_t capacity);
+
+public:
+
+    // Constructor and destructor
+    FlightLog() = default;
+    ~FlightLog();
+
+    // Creates the log file, truncating any existing one
+    bool open(const std::string &path);
+
+    // Appends a simulation step to the log
+    void append(int64_t timestamp, uint32_t episode, uint32_t step, const CarState &cs, const CarControl &cc,
+                uint32_t flags = 0);
+
+    // Number of records written
+    size_t size() const;
+
+    // Trims the file to its records and closes it
+    void close();
+};
+
+
+/**
+    Read-only view over a log file, mapped in memory.
+*/
+class FlightLogReader {
+private:
+    int fd = -1;
+    char* data = nullptr;
+    size_t length = 0;
+    size_t n_records = 0;
+
+public:
+
+    // Constructor and destructor
+    FlightLogReader() = default;
+    ~FlightLogReader();
+
+    // Maps a log file, checking its header
+    bool open(const std::string &path);
+
+    // Number of records
+    size_t size() const { return this->n_records; }
+
+    // Records, in order of writing
+    const FlightRecord* records() const;
+
+    // Unmaps the file
+    void close();
+};
+
+
+#endif // FLIGHTLOG_H__
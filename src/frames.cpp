@@ -0,0 +1,95 @@
+/**
+    frames.cpp
+    Corpora of sensor strings, recorded or synthetic
+
+    @author Antoine Passemiers
+    @version 1.0 10/08/2019
+*/
+
+#include <cmath>
+#include <fstream>
+#include <random>
+
+#include "carstate.h"
+#include "frames.h"
+
+
+using namespace std;
+
+
+/**
+    Loads a corpus of sensor strings, one per line
+    (see the "frames:" option of the client).
+
+    @param path Path to the corpus.
+    @param frames Where to store the sensor strings.
+    @return Whether the corpus could be read.
+*/
+bool loadFrames(const char* path, std::vector<std::string> &frames)
+{
+    ifstream file(path);
+    if (!file.is_open())
+        return false;
+    string line;
+    while (getline(file, line))
+    {
+        if (line.find('(') != string::npos)
+            frames.push_back(line);
+    }
+    return !frames.empty();
+}
+
+/**
+    Synthesizes sensor strings along a fake lap, half of them
+    perturbed with Gaussian noise as with "torcs -noisy".
+
+    @param n Number of frames.
+    @param frames Where to store the sensor strings.
+*/
+void synthesizeFrames(size_t n, std::vector<std::string> &frames)
+{
+    mt19937 gen(42);
+    normal_distribution<float> noise(0.0f, 0.1f);
+    uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    for (size_t t = 0; t < n; t++)
+    {
+        bool noisy = (t % 2 == 1);
+        float phase = 0.01f * t;
+        CarState cs = CarState();
+        cs.angle = 0.1f * sin(phase);
+        cs.curLapTime = 0.02f * t;
+        cs.damage = 0.0f;
+        cs.distFromStart = 1.5f * t;
+        cs.distRaced = 1.5f * t;
+        for (int i = 0; i < FOCUS_SENSORS_NUM; i++)
+            cs.focus[i] = -1.0f;
+        cs.fuel = 94.0f - 0.001f * t;
+        cs.gear = 1 + (t / 50) % 6;
+        cs.lastLapTime = 0.0f;
+        for (int i = 0; i < OPPONENTS_SENSORS_NUM; i++)
+            cs.opponents[i] = (uniform(gen) < 0.05f) ? 200.0f * uniform(gen) : 200.0f;
+        cs.racePos = 1;
+        cs.rpm = 4000 + (int) (3000.0f * uniform(gen));
+        cs.speedX = 150.0f + 50.0f * sin(phase);
+        cs.speedY = 2.0f * cos(phase);
+        cs.speedZ = 0.01f * uniform(gen);
+        for (int i = 0; i < TRACK_SENSORS_NUM; i++)
+            cs.track[i] = 4.0f + 196.0f * pow(sin(M_PI * i / (TRACK_SENSORS_NUM - 1)), 4) * (0.6f + 0.4f * cos(phase));
+        cs.trackPos = 0.3f * sin(0.5f * phase);
+        for (int i = 0; i < 4; i++)
+            cs.wheelSpinVel[i] = cs.speedX / 3.6f / 0.3325f;
+        cs.z = 0.35f;
+
+        if (noisy)
+        {
+            for (int i = 0; i < TRACK_SENSORS_NUM; i++)
+                cs.track[i] *= 1.0f + noise(gen);
+            for (int i = 0; i < OPPONENTS_SENSORS_NUM; i++)
+                cs.opponents[i] *= 1.0f + 0.2f * noise(gen);
+            cs.angle += 0.01f * noise(gen);
+            cs.trackPos += 0.01f * noise(gen);
+        }
+        frames.push_back(cs.toString());
+    }
+}
@@ -0,0 +1,23 @@
+/**
+    frames.h
+    Corpora of sensor strings, recorded or synthetic
+
+    @author Antoine Passemiers
+    @version 1.0 10/08/2019
+*/
+
+#ifndef FRAMES_H__
+#define FRAMES_H__
+
+#include <string>
+#include <vector>
+
+
+// Loads a corpus of sensor strings, one per line
+bool loadFrames(const char* path, std::vector<std::string> &frames);
+
+// Synthesizes sensor strings along a fake lap
+void synthesizeFrames(size_t n, std::vector<std::string> &frames);
+
+
+#endif // FRAMES_H__
@@ -10,9 +10,22 @@
 
 
 /**
-    Constructs the gear module.
+    Constructs the gear module. There are 6 gear increase
+    thresholds and 6 gear decrease thresholds.
 */
-GearModule::GearModule() {
+template <typename T>
+GearModule<T>::GearModule() {
+    for (int i = 0; i < 6; i++) this->storage[i] = GI[i];
+    for (int i = 6; i < 12; i++) this->storage[i] = GD[i - 6];
+    this->reset();
+}
+
+/**
+    Forgets the steps where the car pointed in a wrong direction,
+    as well as any attempt to get unstuck.
+*/
+template <typename T>
+void GearModule<T>::reset() {
     this->stuck = 0; // the car is not stuck yet
     this->getting_unstuck = false;
 }
@@ -23,9 +36,10 @@ GearModule::GearModule() {
     @param cs Current car state.
     @return Whether the car is stuck
 */
-bool GearModule::checkIfStuck(CarState &cs) {
+template <typename T>
+bool GearModule<T>::checkIfStuck(CarState &cs) {
     // Checks whether the car is stuck
-    if (std::abs(cs.angle) > M_PI / 6.0) { // Not aligned with the road
+    if (std::abs(cs.angle) > static_cast<T>(M_PI / 6.0)) { // Not aligned with the road
         this->stuck++;
     } else {
         this->stuck = 0;
@@ -36,7 +50,7 @@ bool GearModule::checkIfStuck(CarState &cs) {
 
     // Checks whether the car should try to get unstuck
     if (this->getting_unstuck) {
-        double front = cs.track[9];
+        T front = cs.track[9];
         // Don't try to get unstuck if there is an obstacle
         if ((cs.angle * cs.trackPos > 0) || ((front > 10) && (std::abs(M_PI) < 2.0))) {
             this->getting_unstuck = false;
@@ -53,7 +67,8 @@ bool GearModule::checkIfStuck(CarState &cs) {
     @param cs Current car state.
     @return Gear selection
 */
-int GearModule::control(CarState &cs) {
+template <typename T>
+int GearModule<T>::control(CarState &cs) {
     // Get gear changing thresholds for current gear selection
     int gear;
     int gd = GearModule::GI[cs.gear + 1];
@@ -71,21 +86,12 @@ int GearModule::control(CarState &cs) {
     return gear;
 }
 
-/**
-    Number of module parameters. There are 6
-    gear increase thresholds and 6 gear decrease thresholds.
-
-    @return Number of module parameters.
-*/
-size_t GearModule::getNumberOfParameters() {
-    return 12;
-}
-
 /**
     @return Lower bounds on the module parameters.
 */
-Eigen::VectorXd GearModule::getLowerBounds() {
-    Eigen::VectorXd lbs = Eigen::VectorXd::Zero(12);
+template <typename T>
+typename GearModule<T>::tVector GearModule<T>::getLowerBounds() {
+    tVector lbs = tVector::Zero();
     for (int i = 0; i < 6; i++) lbs[i] = 3000;
     for (int i = 6; i < 12; i++) lbs[i] = 1000;
     return lbs;
@@ -94,31 +100,14 @@ Eigen::VectorXd GearModule::getLowerBounds() {
 /**
     @return Upper bounds on the module parameters.
 */
-Eigen::VectorXd GearModule::getUpperBounds() {
-    Eigen::VectorXd ubs = Eigen::VectorXd::Zero(12);
+template <typename T>
+typename GearModule<T>::tVector GearModule<T>::getUpperBounds() {
+    tVector ubs = tVector::Zero();
     for (int i = 0; i < 6; i++) ubs[i] = 8000;
     for (int i = 6; i < 12; i++) ubs[i] = 4000;
     return ubs;
 }
 
-/**
-    Gets current values of module parameters.
-
-    @return Current values of module parameters.
-*/
-Eigen::VectorXd GearModule::getParameters() {
-    Eigen::VectorXd parameters = Eigen::VectorXd::Zero(12);
-    for (int i = 0; i < 6; i++) parameters[i] = GI[i];
-    for (int i = 6; i < 12; i++) parameters[i] = GD[i - 6];
-    return parameters;
-}
 
-/**
-    Sets current values of module parameters.
-
-    @param Current values of module parameters.
-*/
-void GearModule::setParameters(Eigen::VectorXd parameters) {
-    for (int i = 0; i < 6; i++) parameters[i] = GI[i];
-    for (int i = 6; i < 12; i++) parameters[i] = GD[i - 6];
-}
+template class GearModule<float>;
+template class GearModule<double>;
@@ -16,10 +16,14 @@
 #include "module.h"
 
 
-class GearModule : Module {
+template <typename T>
+class GearModule : public Module<GearModule<T>, T, 12> {
 private:
 
-    // Gear increase and decrease thresholds
+    // Gear increase and decrease thresholds. Their parameters (6 gear
+    // increase thresholds, then 6 gear decrease thresholds) are
+    // initialized from them, but the thresholds are not updated
+    // from the parameters
     int GI[6] = { 8000, 8000, 8000, 8000, 8000,    0 };
     int GD[6] = {    0, 2500, 3000, 3000, 3500, 3500 };
 
@@ -34,22 +38,32 @@ private:
     bool getting_unstuck;
 
 public:
+    // Base class and parameter vectors
+    typedef Module<GearModule<T>, T, 12> tModule;
+    typedef typename tModule::tVector tVector;
+    static_assert(sizeof(GI) / sizeof(GI[0]) + sizeof(GD) / sizeof(GD[0]) == tModule::N_PARAMETERS,
+        "Parameter layout does not match the module size");
+
+    // Sensors read by the module
+    static constexpr unsigned int SENSORS = sensorMask("angle") | sensorMask("gear")
+        | sensorMask("rpm") | sensorMask("track") | sensorMask("trackPos");
+
     // Constructor and destructor
     GearModule();
     ~GearModule() = default;
 
+    // Forgets whether the car was stuck
+    void reset();
+
     // Checks whether the car is stuck
     bool checkIfStuck(CarState &cs);
 
     // Selects the gear
     int control(CarState &cs);
 
-    // Abstract methods
-    virtual size_t getNumberOfParameters();
-    virtual Eigen::VectorXd getLowerBounds();
-    virtual Eigen::VectorXd getUpperBounds();
-    virtual Eigen::VectorXd getParameters();
-    virtual void setParameters(Eigen::VectorXd parameters);
+    // Bounds on the parameters
+    tVector getLowerBounds();
+    tVector getUpperBounds();
 };
 
 
@@ -0,0 +1,142 @@
+/**
+    latency.cpp
+    Log-bucketed latency histograms and timestamps
+
+    @author Antoine Passemiers
+    @version 1.0 09/08/2019
+*/
+
+#include "latency.h"
+
+
+/**
+    Constructs an empty histogram.
+*/
+LatencyHistogram::LatencyHistogram() {
+    this->reset();
+}
+
+/**
+    Finds the bucket of a value. Values below 16 have their own
+    bucket, larger values are bucketed by power of two and then
+    by their 4 most significant bits after the leading one.
+
+    @param value Non-negative value.
+    @return Bucket index.
+*/
+int LatencyHistogram::bucketIndex(uint64_t value) {
+    if (value < SUB_BUCKETS) return static_cast<int>(value);
+    int e = 63 - __builtin_clzll(value);
+    int sub = static_cast<int>((value >> (e - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return (e - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+/**
+    Lowest value falling in a bucket.
+
+    @param index Bucket index.
+    @return Lowest value of the bucket.
+*/
+int64_t LatencyHistogram::bucketValue(int index) {
+    if (index < SUB_BUCKETS) return index;
+    int e = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    int sub = index % SUB_BUCKETS;
+    return static_cast<int64_t>(SUB_BUCKETS + sub) << (e - SUB_BUCKET_BITS);
+}
+
+/**
+    Records a value. Negative values (clock adjustments)
+    are recorded as 0.
+
+    @param value Value in nanoseconds.
+*/
+void LatencyHistogram::record(int64_t value) {
+    if (value < 0) value = 0;
+    this->counts[bucketIndex(static_cast<uint64_t>(value))]++;
+    this->n_values++;
+    if (value > this->max_value) this->max_value = value;
+}
+
+/**
+    Forgets all recorded values.
+*/
+void LatencyHistogram::reset() {
+    std::memset(this->counts, 0, sizeof(this->counts));
+    this->n_values = 0;
+    this->max_value = 0;
+}
+
+/**
+    Adds the values recorded by another histogram, e.g. for
+    aggregating the histograms of successive episodes.
+
+    @param other Histogram to be added.
+*/
+void LatencyHistogram::add(const LatencyHistogram &other) {
+    for (int i = 0; i < N_BUCKETS; i++) this->counts[i] += other.counts[i];
+    this->n_values += other.n_values;
+    if (other.max_value > this->max_value) this->max_value = other.max_value;
+}
+
+/**
+    @return Number of recorded values.
+*/
+uint64_t LatencyHistogram::count() {
+    return this->n_values;
+}
+
+/**
+    Computes a percentile of the recorded values, with a
+    relative precision of 1/16.
+
+    @param p Percentile, between 0 and 100.
+    @return Lowest value of the bucket containing the percentile.
+*/
+int64_t LatencyHistogram::percentile(double p) {
+    if (this->n_values == 0) return 0;
+    uint64_t target = static_cast<uint64_t>(p / 100.0 * this->n_values + 0.5);
+    if (target < 1) target = 1;
+    uint64_t cumulated = 0;
+    for (int i = 0; i < N_BUCKETS; i++) {
+        cumulated += this->counts[i];
+        if (cumulated >= target) return bucketValue(i);
+    }
+    return this->max_value;
+}
+
+/**
+    @return Largest recorded value.
+*/
+int64_t LatencyHistogram::max() {
+    return this->max_value;
+}
+
+/**
+    Prints the main percentiles and the maximum, in microseconds.
+
+    @param out Output stream.
+    @param name Name of the measured quantity.
+*/
+void LatencyHistogram::report(std::ostream &out, const std::string &name) {
+    out << name << " (us, " << this->n_values << " values):"
+        << " p50 " << this->percentile(50.0) / 1000.0
+        << " p99 " << this->percentile(99.0) / 1000.0
+        << " p99.9 " << this->percentile(99.9) / 1000.0
+        << " max " << this->max_value / 1000.0 << std::endl;
+}
+
+/**
+    @return Current time of the monotonic clock, in nanoseconds.
+*/
+int64_t monotonicNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+    @return Current time of the wall clock, in nanoseconds.
+*/
+int64_t realtimeNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,72 @@
+/**
+    latency.h
+    Log-bucketed latency histograms and timestamps
+
+    @author Antoine Passemiers
+    @version 1.0 09/08/2019
+*/
+
+#ifndef LATENCY_H__
+#define LATENCY_H__
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+
+class LatencyHistogram {
+private:
+    // Number of sub-buckets per power of two (relative precision of 1/16)
+    static constexpr int SUB_BUCKETS = 16;
+    static constexpr int SUB_BUCKET_BITS = 4;
+
+    // Total number of buckets, enough for any 64-bit value
+    static constexpr int N_BUCKETS = 64 * SUB_BUCKETS;
+
+    // Number of values recorded in each bucket
+    uint64_t counts[N_BUCKETS];
+
+    // Number of recorded values
+    uint64_t n_values;
+
+    // Largest recorded value
+    int64_t max_value;
+
+    // Bucket of a value and lowest value of a bucket
+    static int bucketIndex(uint64_t value);
+    static int64_t bucketValue(int index);
+
+public:
+    // Constructor and destructor
+    LatencyHistogram();
+    ~LatencyHistogram() = default;
+
+    // Records a value, in nanoseconds (no allocation, no system call)
+    void record(int64_t value);
+
+    // Forgets all recorded values
+    void reset();
+
+    // Adds the values recorded by another histogram
+    void add(const LatencyHistogram &other);
+
+    // Statistics on the recorded values
+    uint64_t count();
+    int64_t percentile(double p);
+    int64_t max();
+
+    // Prints p50/p99/p99.9/max in microseconds
+    void report(std::ostream &out, const std::string &name);
+};
+
+
+// Monotonic clock, in nanoseconds
+int64_t monotonicNanoseconds();
+
+// Wall clock (used by kernel receive timestamps), in nanoseconds
+int64_t realtimeNanoseconds();
+
+
+#endif // LATENCY_H__
@@ -14,7 +14,8 @@
 
     @param n_inputs: Number of inputs.
 */
-MLP::MLP(size_t n_inputs) : MLP(n_inputs, true) {}
+template <typename T>
+BasicMLP<T>::BasicMLP(size_t n_inputs) : BasicMLP(n_inputs, true) {}
 
 /**
     Constructor.
@@ -22,18 +23,19 @@ MLP::MLP(size_t n_inputs) : MLP(n_inputs, true) {}
     @param n_inputs: Number of inputs.
     @param use_bias: Whether to add biases.
 */
-MLP::MLP(size_t n_inputs, bool use_bias) {
+template <typename T>
+BasicMLP<T>::BasicMLP(size_t n_inputs, bool use_bias) {
     this->n_inputs = n_inputs;
     this->use_bias = use_bias;
 
     // Initialize layer vectors
-    this->A = std::vector<Eigen::MatrixXd>();
-    this->b = std::vector<Eigen::VectorXd>();
-    this->h = std::vector<Eigen::VectorXd>();
+    this->A = std::vector<tMatrix>();
+    this->b = std::vector<tVector>();
+    this->h = std::vector<tVector>();
     this->activations = std::vector<short>();
 
     // Add vector for storing input values
-    this->h.push_back(Eigen::VectorXd::Zero(n_inputs));
+    this->h.push_back(tVector::Zero(n_inputs));
 }
 
 /**
@@ -42,7 +44,8 @@ MLP::MLP(size_t n_inputs, bool use_bias) {
     @param Index of the input value.
     @return Reference to the value.
 */
-double& MLP::in(int i) {
+template <typename T>
+T& BasicMLP<T>::in(int i) {
     return this->h[0][i];
 }
 
@@ -52,7 +55,8 @@ double& MLP::in(int i) {
     @param Index of the output value.
     @return Output value.
 */
-double MLP::out(int i) {
+template <typename T>
+T BasicMLP<T>::out(int i) {
     return this->h[this->h.size() - 1][i];
 }
 
@@ -60,7 +64,8 @@ double MLP::out(int i) {
     Returns the outputs of the network
     as a single vector.
 */
-Eigen::VectorXd& MLP::out() {
+template <typename T>
+typename BasicMLP<T>::tVector& BasicMLP<T>::out() {
     return this->h[this->h.size() - 1];
 }
 
@@ -70,12 +75,13 @@ Eigen::VectorXd& MLP::out() {
     @param n_inputs Number of input neurons.
     @param n_outputs Number of output neurons.
 */
-void MLP::addFullyConnectedLayer(size_t n_inputs, size_t n_outputs) {
-    this->A.push_back(Eigen::MatrixXd::Zero(n_inputs, n_outputs));
+template <typename T>
+void BasicMLP<T>::addFullyConnectedLayer(size_t n_inputs, size_t n_outputs) {
+    this->A.push_back(tMatrix::Zero(n_inputs, n_outputs));
     if (this->use_bias) { // Add biases if required
-        this->b.push_back(Eigen::VectorXd::Zero(n_outputs));
+        this->b.push_back(tVector::Zero(n_outputs));
     }
-    this->h.push_back(Eigen::VectorXd(n_outputs));
+    this->h.push_back(tVector(n_outputs));
 }
 
 /**
@@ -83,7 +89,8 @@ void MLP::addFullyConnectedLayer(size_t n_inputs, size_t n_outputs) {
 
     @param activation Enum representing the activation function.
 */
-void MLP::addActivation(short activation) {
+template <typename T>
+void BasicMLP<T>::addActivation(short activation) {
     this->activations.push_back(activation);
 }
 
@@ -94,7 +101,8 @@ void MLP::addActivation(short activation) {
 
     @return Number of parameters.
 */
-size_t MLP::getNumberOfParameters() {
+template <typename T>
+size_t BasicMLP<T>::getNumberOfParameters() {
     int n = 0;
     for (size_t i = 0; i < this->A.size(); i++) { // For each layer
         n += this->A[i].cols() * this->A[i].rows();
@@ -109,7 +117,8 @@ size_t MLP::getNumberOfParameters() {
 /**
     Initializes parameters values.
 */
-void MLP::initWeights() {
+template <typename T>
+void BasicMLP<T>::initWeights() {
     for (size_t i = 0; i < this->A.size(); i++) { // For each layer
         // Compute standard deviation for the Xavier initialization
         size_t n_in = this->A[i].rows();
@@ -117,14 +126,14 @@ void MLP::initWeights() {
         double variance = 2.0 / (n_in + n_out);
 
         // Sample a Gaussian distribution
-        this->A[i] = randGaussian(n_in, n_out, 0.0, std::sqrt(variance));
+        this->A[i] = randGaussian(n_in, n_out, 0.0, std::sqrt(variance)).cast<T>();
 
         // Initialize biases if present in the network
         // Biases are not zero-initialized since the network
         // is being optimized with a particle swarm.
         if (this->use_bias) {
             variance = 1.0 / n_out;
-            this->b[i] = randGaussian(n_out, 0.0, std::sqrt(variance));
+            this->b[i] = randGaussian(n_out, 0.0, std::sqrt(variance)).cast<T>();
         }
     }
 }
@@ -134,21 +143,20 @@ void MLP::initWeights() {
 
     @return Network parameters.
 */
-Eigen::VectorXd MLP::getWeights() {
+template <typename T>
+typename BasicMLP<T>::tVector BasicMLP<T>::getWeights() {
     // Allocate space for all the parameters
     size_t n = this->getNumberOfParameters();
-    Eigen::VectorXd weights = Eigen::VectorXd::Zero(n);
+    tVector weights = tVector::Zero(n);
 
     int j = 0;
     for (size_t k = 0; k < this->A.size(); k++) { // For each layer
-        Eigen::MatrixXd &A = this->A[k];
+        tMatrix &A = this->A[k];
 
         // Store matrix A line by line in the concatenated vector
         size_t n_inputs = A.rows();
         size_t n_outputs = A.cols();
-        for (size_t i = 0; i < n_inputs; i++) {
-            weights.segment(j + i * n_outputs, n_outputs) = A.row(i);
-        }
+        tRowMajorView(weights.data() + j, n_inputs, n_outputs) = A;
         j += n_inputs * n_outputs;
 
         // Store biases (if present) in the concatenated vector
@@ -167,18 +175,16 @@ Eigen::VectorXd MLP::getWeights() {
 
     @param weights Parameter values, provided as a single vector.
 */
-void MLP::setWeights(const Eigen::VectorXd &weights) {
+template <typename T>
+void BasicMLP<T>::setWeights(const tVector &weights) {
 
     int j = 0;
 
     for (size_t k = 0; k < this->A.size(); k++) { // For each layer
-        // Store values line-by-line in matrix A
+        // Read matrix A, stored line by line, without temporaries
         size_t n_inputs = this->A[k].rows();
         size_t n_outputs = this->A[k].cols();
-        Eigen::VectorXd _A = weights.segment(j, n_inputs * n_outputs);
-        for (size_t i = 0; i < n_inputs; i++) {
-            this->A[k].row(i) = _A.segment(i * n_outputs, n_outputs);
-        }
+        this->A[k] = tConstRowMajorView(weights.data() + j, n_inputs, n_outputs);
         j += n_inputs * n_outputs;
 
         // If present, store the values of the biases
@@ -194,7 +200,8 @@ void MLP::setWeights(const Eigen::VectorXd &weights) {
 /**
     Computes the outputs of the network based on the input values.
 */
-void MLP::forward() {
+template <typename T>
+void BasicMLP<T>::forward() {
     size_t n_layers = this->A.size();
     for (size_t k = 0; k < n_layers; k++) { // For each layer
         // Linear operation
@@ -224,3 +231,7 @@ void MLP::forward() {
         }
     }
 }
+
+
+template class BasicMLP<float>;
+template class BasicMLP<double>;
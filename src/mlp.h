@@ -17,8 +17,18 @@
 #include "utils.h"
 
 
-class MLP {
+template <typename T>
+class BasicMLP {
+public:
+    // Vectors and matrices in the scalar type of the network
+    typedef Eigen::Matrix<T, Eigen::Dynamic, 1> tVector;
+    typedef Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> tMatrix;
+
 private:
+    // Views over weights stored line by line in the concatenated parameters
+    typedef Eigen::Map<Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> tRowMajorView;
+    typedef Eigen::Map<const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> tConstRowMajorView;
+
 
     // Number of inputs
     size_t n_inputs;
@@ -27,20 +37,20 @@ private:
     bool use_bias;
 
     // Layers inputs/outputs
-    std::vector<Eigen::VectorXd> h;
+    std::vector<tVector> h;
 
     // Layers parameters
-    std::vector<Eigen::MatrixXd> A;
-    std::vector<Eigen::VectorXd> b;
+    std::vector<tMatrix> A;
+    std::vector<tVector> b;
 
     // Activation functions
     std::vector<short> activations;
 
 public:
     // Constructors and destructor
-    MLP(size_t n_inputs);
-    MLP(size_t n_inputs, bool use_bias);
-    ~MLP() = default;
+    BasicMLP(size_t n_inputs);
+    BasicMLP(size_t n_inputs, bool use_bias);
+    ~BasicMLP() = default;
 
     void addFullyConnectedLayer(size_t n_inputs, size_t n_outputs);
     void addActivation(short activation);
@@ -48,21 +58,24 @@ public:
     // Network input and output.
     // These accessors allow the controller
     // to access values one-by-one (e.g. accelCmd).
-    double& in(int i);
-    double out(int i);
-    Eigen::VectorXd& out();
+    T& in(int i);
+    T out(int i);
+    tVector& out();
 
     // Number of parameters in the network
     size_t getNumberOfParameters();
 
     // Set parameters values
     void initWeights();
-    void setWeights(const Eigen::VectorXd &weights);
-    Eigen::VectorXd getWeights();
+    void setWeights(const tVector &weights);
+    tVector getWeights();
 
     // Refresh the output values
     void forward();
 
 };
 
+// Double-precision network
+typedef BasicMLP<double> MLP;
+
 #endif // MLP_H__
@@ -1,6 +1,6 @@
 /**
     module.h
-    Base class for modules
+    Base class for modules, and chains of modules
     
     @author Antoine Passemiers
     @version 1.0 05/08/2019
@@ -10,15 +10,191 @@
 #define MODULE_H__
 
 #include <Eigen/Core>
+#include <cstddef>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 
+// Scalar type the modules compute with: double by default, or the
+// type given by SCALAR in the Makefile (e.g. float for inference)
+#ifdef __DRIVER_SCALAR__
+typedef __DRIVER_SCALAR__ tScalar;
+#else
+typedef double tScalar;
+#endif
+
+
+/**
+    Base class for modules, with static polymorphism: a module derives
+    from Module<itself, T, N>, so that calls go to the module's own
+    methods without virtual dispatch. The parameters of a module are
+    read through a view, which points either to the module's own storage
+    or to its slice of a buffer holding the parameters of all the
+    modules (see bind). Modules cannot be copied, since their views may
+    point to their own storage.
+
+    Besides the methods below, a module provides getLowerBounds()
+    and getUpperBounds(), returning vectors of type tVector.
+
+    @param Derived Module class.
+    @param T Scalar type of the parameters.
+    @param N Number of module parameters.
+*/
+template <typename Derived, typename T, size_t N>
 class Module {
 public:
-    virtual size_t getNumberOfParameters() = 0;
-    virtual Eigen::VectorXd getLowerBounds() = 0;
-    virtual Eigen::VectorXd getUpperBounds() = 0;
-    virtual Eigen::VectorXd getParameters() = 0;
-    virtual void setParameters(Eigen::VectorXd parameters) = 0;
+    // Number of module parameters, known at compile time
+    static constexpr size_t N_PARAMETERS = N;
+
+    // Parameter vectors, and views over parameters stored elsewhere
+    typedef Eigen::Matrix<T, N, 1> tVector;
+    typedef Eigen::Map<tVector> tView;
+
+protected:
+    // Default values of the parameters, used until the module is bound
+    tVector storage;
+
+    // Current values of the parameters
+    tView parameters;
+
+    // Modules are not destroyed through this class
+    ~Module() = default;
+
+public:
+    /**
+        Constructs a module viewing its own storage.
+    */
+    Module() : storage(tVector::Zero()), parameters(storage.data()) {}
+    Module(const Module &) = delete;
+    Module& operator=(const Module &) = delete;
+
+    /**
+        Makes the module read its parameters from the given buffer,
+        which must outlive the module or be unbound before. A module
+        reading parameters elsewhere as well hides this method.
+
+        @param data First of the N values.
+    */
+    void bind(T* data) {
+        new (&this->parameters) tView(data);
+    }
+
+    /**
+        Makes the module read its parameters from its own storage again.
+    */
+    void unbind() {
+        static_cast<Derived*>(this)->bind(this->storage.data());
+    }
+
+    /**
+        @return Number of module parameters.
+    */
+    static constexpr size_t getNumberOfParameters() {
+        return N;
+    }
+
+    /**
+        @return Current values of module parameters.
+    */
+    tVector getParameters() {
+        return this->parameters;
+    }
+
+    /**
+        Sets current values of module parameters, wherever they are stored.
+
+        @param parameters Current values of module parameters.
+    */
+    void setParameters(const tVector &parameters) {
+        this->parameters = parameters;
+    }
+};
+
+
+/**
+    Modules whose parameters are laid out one after the other in a
+    single buffer, in the order of the modules. The offsets of the
+    slices and the total number of parameters are compile-time
+    constants, and the modules are reached by type, so that a module
+    missing from the chain or present twice is a compile error.
+
+    @param Modules Module classes, each deriving from Module.
+*/
+template <typename... Modules>
+class ModuleChain {
+private:
+    // Modules, in the order of their slices
+    std::tuple<Modules...> modules;
+
+    // Number of parameters of each module
+    static constexpr size_t SIZES[] = { Modules::N_PARAMETERS..., 0 };
+
+    // Offset of the slice of module M, searched from the I-th module
+    template <typename M, size_t I>
+    static constexpr size_t offsetFrom() {
+        static_assert(I < sizeof...(Modules), "Module not in the chain");
+        if constexpr (std::is_same_v<M, std::tuple_element_t<I, std::tuple<Modules...>>>) {
+            return offset<I>();
+        } else {
+            return offsetFrom<M, I + 1>();
+        }
+    }
+
+    // Calls f on each module and the offset of its slice
+    template <typename F, size_t... I>
+    void forEach(F &&f, std::index_sequence<I...>) {
+        (f(std::get<I>(this->modules), std::integral_constant<size_t, offset<I>()>()), ...);
+    }
+
+public:
+    // Number of modules
+    static constexpr size_t N_MODULES = sizeof...(Modules);
+
+    // Total number of parameters
+    static constexpr size_t N_PARAMETERS = (Modules::N_PARAMETERS + ... + 0);
+
+    // Sensors read by the modules
+    static constexpr unsigned int SENSORS = (Modules::SENSORS | ... | 0u);
+
+    /**
+        @return Offset of the slice of the I-th module.
+    */
+    template <size_t I>
+    static constexpr size_t offset() {
+        static_assert(I <= N_MODULES, "Module index out of range");
+        size_t offset = 0;
+        for (size_t i = 0; i < I; i++) offset += SIZES[i];
+        return offset;
+    }
+
+    /**
+        @return Offset of the slice of module M.
+    */
+    template <typename M>
+    static constexpr size_t offsetOf() {
+        return offsetFrom<M, 0>();
+    }
+
+    /**
+        @return Module M of the chain.
+    */
+    template <typename M>
+    M& get() {
+        return std::get<M>(this->modules);
+    }
+
+    /**
+        Calls a function on each module, in order, with the offset of
+        its slice as an std::integral_constant.
+
+        @param f Function of a module and of an offset (a generic lambda).
+    */
+    template <typename F>
+    void forEach(F &&f) {
+        this->forEach(std::forward<F>(f), std::index_sequence_for<Modules...>());
+    }
 };
 
 
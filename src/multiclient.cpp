@@ -0,0 +1,451 @@
+/**
+    multiclient.cpp
+    Single-process client driving several cars (Linux only)
+
+    Each car has its own UDP socket, talking to the server port
+    3001 + i, and its own driver. All sockets are multiplexed with
+    epoll, pending datagrams are read in batches with recvmmsg and
+    the replies of a socket are sent in batches with sendmmsg.
+
+    @author Antoine Passemiers
+    @version 1.0 08/08/2019
+*/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "JerryTheRaceCarDriver.h"
+
+/*** defines for UDP *****/
+#define UDP_MSGLEN 1000
+#define UDP_CLIENT_TIMEUOT 1000000
+#define UDP_INIT_BACKOFF_MIN 100000
+#define UDP_BATCH 8
+#define MAX_CARS 10
+/************************/
+
+using namespace std;
+
+typedef chrono::steady_clock tClock;
+
+// State of the connection of a car with the server
+typedef enum { IDENTIFYING, DRIVING, DONE } tCarStatus;
+
+// A car: socket, driver and position in the race protocol
+typedef struct
+{
+    int socket;
+    unsigned int port;
+    JerryTheRaceCarDriver* driver;
+    tCarStatus status;
+    unsigned long currentStep;
+    unsigned long curEpisode;
+
+    // Identification attempts: next one, current timeout (us),
+    // number of attempts, time at which they started and time
+    // the last one was sent
+    tClock::time_point nextInit;
+    long initTimeout;
+    unsigned int nAttempts;
+    tClock::time_point identifyStart;
+    tClock::time_point initSent;
+
+    // First identification timeout (us), and slowest answer of the
+    // server to a re-identification (see startIdentification)
+    long initBackoff;
+    tClock::duration slowestAnswer;
+
+    // Replies waiting to be sent with sendmmsg
+    char replies[UDP_BATCH][UDP_MSGLEN];
+    struct iovec replyIov[UDP_BATCH];
+    struct mmsghdr replyMsgs[UDP_BATCH];
+    unsigned int nReplies;
+} tCar;
+
+// Command line options
+typedef struct
+{
+    char hostName[1000];
+    unsigned int serverPort;
+    unsigned int nCars;
+    char id[1000];
+    unsigned int maxEpisodes;
+    unsigned int maxSteps;
+    char trackName[1000];
+    JerryTheRaceCarDriver::tstage stage;
+    bool train;
+    char modelPath[1000];
+    unsigned int seed;
+    long budget;
+} tOptions;
+
+
+void parse_args(int argc, char *argv[], tOptions &options);
+
+/**
+    Starts the identification of a car for a new episode. The simulator
+    reads one message per step, hence an init string resent while the
+    answer to the previous one is on its way would be read as an action,
+    shifting all the actions of the episode. The first timeout is twice
+    the slowest answer to a re-identification (UDP_CLIENT_TIMEUOT until
+    one is measured).
+*/
+void startIdentification(tCar &car)
+{
+    car.status = IDENTIFYING;
+    car.initTimeout = car.initBackoff;
+    car.nAttempts = 0;
+    car.identifyStart = tClock::now();
+}
+
+/**
+    Sends the identification string of a car, and schedules
+    the next attempt in case the server does not answer. The
+    delay doubles at each attempt, up to UDP_CLIENT_TIMEUOT.
+*/
+void identify(tCar &car, const string &initString)
+{
+    if (send(car.socket, initString.c_str(), initString.length(), 0) < 0)
+        cerr << "cannot send data to port " << car.port << "\n";
+    car.initSent = tClock::now();
+    car.nextInit = car.initSent + chrono::microseconds(car.initTimeout);
+    car.initTimeout = min(2 * car.initTimeout, (long) UDP_CLIENT_TIMEUOT);
+    car.nAttempts++;
+}
+
+/**
+    Sends the replies queued by a car.
+*/
+void flushReplies(tCar &car)
+{
+    if (car.nReplies > 0)
+    {
+        if (sendmmsg(car.socket, car.replyMsgs, car.nReplies, 0) < 0)
+            cerr << "cannot send data to port " << car.port << "\n";
+        car.nReplies = 0;
+    }
+}
+
+/**
+    Queues a reply of a car, flushing the queue if it is full.
+*/
+char* nextReply(tCar &car)
+{
+    if (car.nReplies == UDP_BATCH)
+        flushReplies(car);
+    return car.replies[car.nReplies];
+}
+
+/**
+    Handles a datagram received by a car, queuing
+    a reply if the datagram carries sensors.
+*/
+void handle(tCar &car, const char* buf, size_t len, const tOptions &options, const string &initString)
+{
+    if (car.status == IDENTIFYING)
+    {
+        if (strcmp(buf, "***identified***") == 0)
+        {
+            tClock::time_point now = tClock::now();
+            chrono::duration<double, milli> elapsed = now - car.identifyStart;
+
+            // Only a single attempt tells how long the server takes to answer
+            if ((car.curEpisode > 0) && (car.nAttempts == 1))
+            {
+                car.slowestAnswer = max(car.slowestAnswer, now - car.initSent);
+                long answer = (long) chrono::duration_cast<chrono::microseconds>(car.slowestAnswer).count();
+                car.initBackoff = min(max(2 * answer, (long) UDP_INIT_BACKOFF_MIN), (long) UDP_CLIENT_TIMEUOT);
+            }
+            cout << "Car " << car.port << ": identified in " << elapsed.count() << " ms ("
+                 << car.nAttempts << " attempts)" << endl;
+            car.driver->restart();
+            car.status = DRIVING;
+            car.currentStep = 0;
+        }
+        return;
+    }
+    if (car.status != DRIVING)
+        return;
+
+    if (strcmp(buf, "***shutdown***") == 0)
+    {
+        bool shutdownCar = car.driver->readyToShutdown();
+        car.driver->restart();
+        cout << "Car " << car.port << ": Client Shutdown" << endl;
+        if (shutdownCar)
+        {
+            car.status = DONE;
+            return;
+        }
+    }
+    else if (strcmp(buf, "***restart***") == 0)
+    {
+        car.driver->restart();
+        cout << "Car " << car.port << ": Client Restart" << endl;
+    }
+    else
+    {
+        char* reply = nextReply(car);
+        size_t replyLength;
+        if ((++car.currentStep) != options.maxSteps)
+            replyLength = car.driver->drive(string_view(buf, len), reply, UDP_MSGLEN);
+        else
+            replyLength = sprintf(reply, "(meta 1)");
+        car.replyIov[car.nReplies].iov_len = replyLength + 1;
+        car.nReplies++;
+        return;
+    }
+
+    // End of the episode
+    if ((++car.curEpisode) == options.maxEpisodes)
+    {
+        car.status = DONE;
+    }
+    else
+    {
+        // The actions queued from the same batch answer steps of the
+        // episode that just ended, and must reach the server before
+        // the init string
+        flushReplies(car);
+        startIdentification(car);
+        identify(car, initString);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    tOptions options;
+    parse_args(argc, argv, options);
+
+    struct hostent *hostInfo = gethostbyname(options.hostName);
+    if (hostInfo == NULL)
+    {
+        cout << "Error: problem interpreting host: " << options.hostName << "\n";
+        exit(1);
+    }
+
+    cout << "***********************************" << endl;
+    cout << "HOST: " << options.hostName << endl;
+    cout << "PORTS: " << options.serverPort << ".." << options.serverPort + options.nCars - 1 << endl;
+    cout << "ID: " << options.id << endl;
+    cout << "MAX_STEPS: " << options.maxSteps << endl;
+    cout << "MAX_EPISODES: " << options.maxEpisodes << endl;
+    cout << "TRACKNAME: " << options.trackName << endl;
+    cout << "***********************************" << endl;
+
+    srand(options.seed);
+
+    // Initialize the angles of rangefinders (the same for all the cars)
+    float angles[19];
+    JerryTheRaceCarDriver::init(angles);
+    string initString = SimpleParser::stringify(string("init"), angles, 19);
+    initString.insert(0, options.id);
+
+    int epollDescriptor = epoll_create1(0);
+    if (epollDescriptor < 0)
+    {
+        cerr << "cannot create epoll instance\n";
+        exit(1);
+    }
+
+    // Create one socket and one driver per car
+    vector<tCar*> cars;
+    for (unsigned int i = 0; i < options.nCars; i++)
+    {
+        tCar* car = new tCar();
+        car->port = options.serverPort + i;
+        car->socket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (car->socket < 0)
+        {
+            cerr << "cannot create socket\n";
+            exit(1);
+        }
+
+        // Connect the socket to the server port of the car, so that
+        // datagrams from other ports are filtered out by the kernel
+        struct sockaddr_in serverAddress;
+        memset(&serverAddress, 0, sizeof(serverAddress));
+        serverAddress.sin_family = hostInfo->h_addrtype;
+        memcpy((char *) &serverAddress.sin_addr.s_addr, hostInfo->h_addr_list[0], hostInfo->h_length);
+        serverAddress.sin_port = htons(car->port);
+        if (connect(car->socket, (struct sockaddr *) &serverAddress, sizeof(serverAddress)) < 0)
+        {
+            cerr << "cannot connect to port " << car->port << "\n";
+            exit(1);
+        }
+
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u32 = i;
+        if (epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, car->socket, &event) < 0)
+        {
+            cerr << "cannot register socket\n";
+            exit(1);
+        }
+
+        for (int k = 0; k < UDP_BATCH; k++)
+        {
+            car->replyIov[k].iov_base = car->replies[k];
+            car->replyMsgs[k].msg_hdr.msg_iov = &car->replyIov[k];
+            car->replyMsgs[k].msg_hdr.msg_iovlen = 1;
+        }
+
+        car->driver = new JerryTheRaceCarDriver();
+        strcpy(car->driver->trackName, options.trackName);
+        car->driver->stage = options.stage;
+        string modelPath(options.modelPath);
+        if (options.train && (options.nCars > 1))
+            modelPath += "." + to_string(car->port); // One parameter file per car
+        car->driver->setModelLocation(modelPath, options.train);
+        car->driver->setBudget(options.budget);
+
+        car->initBackoff = UDP_CLIENT_TIMEUOT;
+        car->slowestAnswer = tClock::duration::zero();
+        startIdentification(*car);
+        identify(*car, initString);
+        cars.push_back(car);
+    }
+
+    // Receive buffers, shared by all the cars
+    static char bufs[UDP_BATCH][UDP_MSGLEN + 1];
+    struct iovec iov[UDP_BATCH];
+    struct mmsghdr msgs[UDP_BATCH];
+    for (int k = 0; k < UDP_BATCH; k++)
+    {
+        iov[k].iov_base = bufs[k];
+        iov[k].iov_len = UDP_MSGLEN;
+        msgs[k].msg_hdr.msg_iov = &iov[k];
+        msgs[k].msg_hdr.msg_iovlen = 1;
+        msgs[k].msg_hdr.msg_name = NULL;
+        msgs[k].msg_hdr.msg_namelen = 0;
+        msgs[k].msg_hdr.msg_control = NULL;
+        msgs[k].msg_hdr.msg_controllen = 0;
+    }
+
+    struct epoll_event events[MAX_CARS];
+    unsigned int nActive = options.nCars;
+    while (nActive > 0)
+    {
+        // Wait until a datagram arrives or an identification attempt expires
+        tClock::time_point now = tClock::now();
+        tClock::time_point deadline = now + chrono::microseconds(UDP_CLIENT_TIMEUOT);
+        for (size_t i = 0; i < cars.size(); i++)
+        {
+            if ((cars[i]->status == IDENTIFYING) && (cars[i]->nextInit < deadline))
+                deadline = cars[i]->nextInit;
+        }
+        int timeout = (int) chrono::ceil<chrono::milliseconds>(deadline - now).count();
+        int nEvents = epoll_wait(epollDescriptor, events, MAX_CARS, max(timeout, 0));
+        if (nEvents < 0)
+        {
+            cerr << "epoll_wait failed\n";
+            break;
+        }
+
+        for (int e = 0; e < nEvents; e++)
+        {
+            tCar &car = *cars[events[e].data.u32];
+            int nRead = recvmmsg(car.socket, msgs, UDP_BATCH, MSG_DONTWAIT, NULL);
+            if (nRead < 0)
+                continue;
+            for (int k = 0; k < nRead; k++)
+            {
+                size_t len = msgs[k].msg_len;
+                bufs[k][len] = '\0';
+                handle(car, bufs[k], len, options, initString);
+            }
+            flushReplies(car);
+        }
+
+        // Retry identification for the cars whose server did not answer
+        now = tClock::now();
+        nActive = 0;
+        for (size_t i = 0; i < cars.size(); i++)
+        {
+            if ((cars[i]->status == IDENTIFYING) && (cars[i]->nextInit <= now))
+                identify(*cars[i], initString);
+            if (cars[i]->status != DONE)
+                nActive++;
+        }
+    }
+
+    for (size_t i = 0; i < cars.size(); i++)
+    {
+        close(cars[i]->socket);
+        delete cars[i]->driver;
+        delete cars[i];
+    }
+    close(epollDescriptor);
+    return 0;
+}
+
+void parse_args(int argc, char *argv[], tOptions &options)
+{
+    // Set default values
+    strcpy(options.hostName, "localhost");
+    options.serverPort = 3001;
+    options.nCars = MAX_CARS;
+    strcpy(options.id, "SCR");
+    options.maxEpisodes = 0;
+    options.maxSteps = 0;
+    strcpy(options.trackName, "unknown");
+    options.stage = JerryTheRaceCarDriver::UNKNOWN;
+    options.train = false;
+    strcpy(options.modelPath, ".");
+    options.seed = 0;
+    options.budget = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "host:", 5) == 0)
+            sprintf(options.hostName, "%s", argv[i] + 5);
+        else if (strncmp(argv[i], "port:", 5) == 0)
+            sscanf(argv[i], "port:%u", &options.serverPort);
+        else if (strncmp(argv[i], "cars:", 5) == 0)
+            sscanf(argv[i], "cars:%u", &options.nCars);
+        else if (strncmp(argv[i], "id:", 3) == 0)
+            sprintf(options.id, "%s", argv[i] + 3);
+        else if (strncmp(argv[i], "maxEpisodes:", 12) == 0)
+            sscanf(argv[i], "maxEpisodes:%u", &options.maxEpisodes);
+        else if (strncmp(argv[i], "maxSteps:", 9) == 0)
+            sscanf(argv[i], "maxSteps:%u", &options.maxSteps);
+        else if (strncmp(argv[i], "track:", 6) == 0)
+            sscanf(argv[i], "track:%s", options.trackName);
+        else if (strncmp(argv[i], "stage:", 6) == 0)
+        {
+            int temp;
+            sscanf(argv[i], "stage:%d", &temp);
+            options.stage = (JerryTheRaceCarDriver::tstage) temp;
+            if (options.stage < JerryTheRaceCarDriver::WARMUP || options.stage > JerryTheRaceCarDriver::RACE)
+                options.stage = JerryTheRaceCarDriver::UNKNOWN;
+        }
+        else if (strncmp(argv[i], "train", 5) == 0)
+            options.train = true;
+        else if (strncmp(argv[i], "model:", 6) == 0)
+            sscanf(argv[i], "model:%s", options.modelPath);
+        else if (strncmp(argv[i], "seed:", 5) == 0)
+            sscanf(argv[i], "seed:%u", &options.seed);
+        else if (strncmp(argv[i], "budget:", 7) == 0)
+            sscanf(argv[i], "budget:%ld", &options.budget);
+    }
+    if (options.nCars < 1)
+        options.nCars = 1;
+    if (options.nCars > MAX_CARS)
+        options.nCars = MAX_CARS;
+}
@@ -12,38 +12,53 @@
 #include <Eigen/Core>
 
 #include "carstate.h"
+#include "carfeatures.h"
 #include "module.h"
 
 
-class OpponentsModule : Module {
+template <typename T>
+class OpponentsModule : public Module<OpponentsModule<T>, T, 17> {
 private:
     // Index of the front sensor
     static constexpr int FRONT = 18;
 
-    // Tolerance thresholds of sensors for braking
-    //                     +-40° +-30° +-20° +-10°  0°  
-    double tol_brake[5] = { 6.0,  6.5,  7.0,  7.5, 8.0 };
+    // Offsets of the parameters: 5 brake tolerance thresholds,
+    // 6 overtake tolerance thresholds and 6 steering increments
+    static constexpr int TOL_BRAKE = 0;
+    static constexpr int TOL_OVERTAKE = 5;
+    static constexpr int INC_OVERTAKE = 11;
 
-    // Tolerance thresholds and increments for overtaking
-    //                          > 50°  +-50°  +-40°  +-30°  +-20°  < 20°
-    double tol_overtake[6] = {   10.,   12.,   14.,   16.,   18.,    20. };
-    double inc_overtake[6] = {  0.10,  0.12,  0.14,  0.16,  0.18,  0.20 };
+    // Default tolerance thresholds of sensors for braking
+    //                                      +-40° +-30° +-20° +-10°  0°  
+    static constexpr T DEFAULT_TOL_BRAKE[5] = { 6.0,  6.5,  7.0,  7.5, 8.0 };
+
+    // Default tolerance thresholds and increments for overtaking
+    //                                           > 50°  +-50°  +-40°  +-30°  +-20°  < 20°
+    static constexpr T DEFAULT_TOL_OVERTAKE[6] = {   10.,   12.,   14.,   16.,   18.,    20. };
+    static constexpr T DEFAULT_INC_OVERTAKE[6] = {  0.10,  0.12,  0.14,  0.16,  0.18,  0.20 };
 public:
+    // Base class and parameter vectors
+    typedef Module<OpponentsModule<T>, T, 17> tModule;
+    typedef typename tModule::tVector tVector;
+    static_assert(TOL_OVERTAKE == TOL_BRAKE + 5 && INC_OVERTAKE == TOL_OVERTAKE + 6
+        && INC_OVERTAKE + 6 == tModule::N_PARAMETERS, "Parameter layout does not match the module size");
+
+    // Sensors read by the module
+    static constexpr unsigned int SENSORS = sensorMask("opponents") | sensorMask("speedX")
+        | sensorMask("speedY") | sensorMask("speedZ");
+
     // Constructor
-    OpponentsModule() = default;
+    OpponentsModule();
 
     // Updates car control based on opponents sensors
-    void control(CarState &cs, double &steer, double &accelbrake);
+    void control(CarState &cs, const CarFeatures<T> &features, T &steer, T &accelbrake);
 
     // Checks whether an opponent is close to the car
     bool violatedSecurityDistance(CarState &cs);
 
-    // Abstract methods
-    virtual size_t getNumberOfParameters();
-    virtual Eigen::VectorXd getLowerBounds();
-    virtual Eigen::VectorXd getUpperBounds();
-    virtual Eigen::VectorXd getParameters();
-    virtual void setParameters(Eigen::VectorXd parameters);
+    // Bounds on the parameters
+    tVector getLowerBounds();
+    tVector getUpperBounds();
 };
 
 
@@ -0,0 +1,309 @@
+/**
+    pipeline.cpp
+    Client pipeline: network, control and telemetry threads
+
+    @author Antoine Passemiers
+    @version 1.0 13/08/2019
+*/
+
+#include "pipeline.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+#include <pthread.h>
+
+#include "realtime.h"
+
+
+// Number of empty polls before a waiting thread starts yielding its core
+#define PIPELINE_SPIN 4096
+
+// Sleeping time of the idle telemetry thread, in microseconds
+#define TELEMETRY_IDLE_SLEEP 1000
+
+
+// Spinning only pays off when the threads have cores of their own
+static const unsigned int spin = (std::thread::hardware_concurrency() > 2) ? PIPELINE_SPIN : 0;
+
+/**
+    Waits a little while polling a ring: spins first, then yields the core.
+
+    @param idle Number of empty polls so far.
+*/
+static inline void relax(unsigned int &idle) {
+    if (++idle < spin) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    } else {
+        std::this_thread::yield();
+    }
+}
+
+
+Pipeline::Pipeline(Transport* transport, JerryTheRaceCarDriver &driver, FlightLog* flight_log, FILE* frames_file, int cpu) :
+    transport(transport), driver(driver), flight_log(flight_log), frames_file(frames_file) {
+    // The network thread is the caller, and the control thread gets the next core
+    this->control_thread = std::thread(&Pipeline::control, this);
+    if (cpu >= 0) {
+        if (!pinThread(pthread_self(), cpu))
+            std::cerr << "cannot pin the network thread to cpu " << cpu << std::endl;
+        if (!pinThread(this->control_thread.native_handle(), cpu + 1))
+            std::cerr << "cannot pin the control thread to cpu " << cpu + 1 << std::endl;
+    }
+    this->telemetry_thread = std::thread(&Pipeline::report, this);
+}
+
+Pipeline::~Pipeline() {
+    this->stop = true;
+    this->control_thread.join();
+    this->telemetry_thread.join();
+}
+
+/**
+    @return Handle of the control thread, e.g. for changing its scheduling.
+*/
+std::thread::native_handle_type Pipeline::controlThread() {
+    return this->control_thread.native_handle();
+}
+
+/**
+    @return Latencies of all the finished episodes (to be read
+        between episodes only).
+*/
+LatencyHistogram& Pipeline::totalLatency() {
+    return this->total_latency;
+}
+
+TelemetryEvent* Pipeline::claimEvent() {
+    TelemetryEvent* event = this->telemetry.claim();
+    if (event == nullptr) this->dropped_events++;
+    return event;
+}
+
+/**
+    Control thread: decodes the messages handed by the network
+    thread, and hands back the actions of the driver.
+*/
+void Pipeline::control() {
+    unsigned int idle = 0;
+    uint32_t step = 0;
+    while (!this->stop) {
+        PipelineFrame* frame = this->frames.front();
+        PipelineAction* action = (frame != nullptr) ? this->actions.claim() : nullptr;
+        if (action == nullptr) {
+            relax(idle);
+            continue;
+        }
+        idle = 0;
+
+        action->rx_time = frame->rx_time;
+        if (strcmp(frame->data, "***shutdown***") == 0) {
+            action->kind = PipelineAction::SHUTDOWN;
+            action->ready = this->driver.readyToShutdown();
+            this->driver.restart();
+            step = 0;
+        } else if (strcmp(frame->data, "***restart***") == 0) {
+            action->kind = PipelineAction::RESTART;
+            this->driver.restart();
+            step = 0;
+        } else {
+            action->kind = PipelineAction::ACTION;
+            action->step = ++step;
+            if (step != this->max_steps) {
+                action->length = this->driver.drive(
+                    std::string_view(frame->data, frame->length), action->data, TRANSPORT_MSGLEN, frame->rx_time);
+                if (this->flight_log != nullptr) {
+                    action->state = this->driver.input();
+                    action->control = this->driver.cc;
+                    action->flags = this->driver.fellBack() ? FLIGHT_RECORD_FALLBACK : 0;
+                }
+            } else {
+                action->length = sprintf(action->data, "(meta 1)");
+                action->step = 0;
+            }
+        }
+        this->frames.pop();
+        this->actions.publish();
+    }
+}
+
+/**
+    Telemetry thread: records frames and flight log, measures
+    latencies, and prints the reports at the end of the episodes.
+*/
+void Pipeline::report() {
+    int64_t last_rx_time = 0;
+    while (true) {
+        TelemetryEvent* event = this->telemetry.front();
+        if (event == nullptr) {
+            if (this->stop) break;
+            std::this_thread::sleep_for(std::chrono::microseconds(TELEMETRY_IDLE_SLEEP));
+            continue;
+        }
+
+        switch (event->kind) {
+        case TelemetryEvent::FRAME:
+            // Binary frames are recorded as text
+            if (codec::isBinary(event->data, event->length))
+                fputs(CarState(event->data, event->length).toString().c_str(), this->frames_file);
+            else
+                fputs(event->data, this->frames_file);
+            fputc('\n', this->frames_file);
+            break;
+        case TelemetryEvent::STEP:
+            this->latency.record(event->tx_time - event->rx_time);
+            if (last_rx_time != 0)
+                this->inter_arrival.record(event->rx_time - last_rx_time);
+            last_rx_time = event->rx_time;
+            if ((this->flight_log != nullptr) && (event->step != 0))
+                this->flight_log->append(event->rx_time, event->episode, event->step, event->state, event->control,
+                                        event->flags);
+            break;
+        case TelemetryEvent::RESTART:
+        case TelemetryEvent::SHUTDOWN:
+            std::cout << ((event->kind == TelemetryEvent::RESTART) ? "Client Restart" : "Client Shutdown") << std::endl;
+            std::cout << "Dropped frames: " << event->dropped << ", dropped telemetry events: "
+                      << this->dropped_events.exchange(0) << std::endl;
+            this->latency.report(std::cout, "Latency recv->send");
+            this->inter_arrival.report(std::cout, "Inter-arrival");
+            this->total_latency.add(this->latency);
+            this->latency.reset();
+            this->inter_arrival.reset();
+            last_rx_time = 0;
+            break;
+        }
+        this->telemetry.pop();
+    }
+}
+
+/**
+    Network thread: sends the actions that are ready.
+
+    @param in_flight Number of messages handed to the control thread
+        and not answered yet.
+    @param end Where to copy the answer to a restart or shutdown.
+    @return Whether the actions could be sent.
+*/
+bool Pipeline::sendActions(unsigned int &in_flight, PipelineAction &end) {
+    PipelineAction* action;
+    while ((action = this->actions.front()) != nullptr) {
+        in_flight--;
+        if (action->kind != PipelineAction::ACTION) {
+            end.kind = action->kind;
+            end.ready = action->ready;
+            this->actions.pop();
+            return true;
+        }
+        if (!this->transport->send(action->data, action->length + 1)) {
+            std::cerr << "cannot send data ";
+            return false;
+        }
+        int64_t tx_time = monotonicNanoseconds();
+        TelemetryEvent* event = this->claimEvent();
+        if (event != nullptr) {
+            event->kind = TelemetryEvent::STEP;
+            event->rx_time = action->rx_time;
+            event->tx_time = tx_time;
+            event->episode = this->episode;
+            event->step = action->step;
+            if (this->flight_log != nullptr) {
+                event->state = action->state;
+                event->control = action->control;
+                event->flags = action->flags;
+            }
+            this->telemetry.publish();
+        }
+        this->actions.pop();
+    }
+    return true;
+}
+
+/**
+    Network thread: receives the messages of the server and sends the
+    actions, until the server restarts or shuts down the race. The
+    thread busy-waits for the action while a message is being handled,
+    and otherwise blocks on the transport.
+
+    @param episode Index of the episode, for the flight log.
+    @param max_steps Number of steps after which a restart is
+        requested (0 for no limit).
+    @param timeout Time in microseconds after which a silent server
+        is reported.
+    @return Whether the client should shut down.
+*/
+bool Pipeline::runEpisode(unsigned long episode, unsigned int max_steps, long timeout) {
+    // Published to the control thread along with the first frame
+    this->episode = episode;
+    this->max_steps = max_steps;
+    this->dropped_frames = 0;
+
+    // Kernel receive timestamps use the wall clock: they are mapped to the
+    // monotonic clock with an offset refreshed at each episode
+    this->transport->synchronizeClocks();
+
+    char overflow[TRANSPORT_MSGLEN];
+    unsigned int in_flight = 0;
+    unsigned int idle = 0;
+    bool ending = false;
+    PipelineAction end;
+    end.kind = PipelineAction::ACTION;
+    while (end.kind == PipelineAction::ACTION) {
+        // Messages that come after a restart or shutdown belong to no episode
+        if (ending) {
+            this->sendActions(in_flight, end);
+            relax(idle);
+            continue;
+        }
+
+        // Messages are received straight into the ring, unless it is full
+        // (the control thread cannot keep up), in which case they are dropped
+        PipelineFrame* frame = this->frames.claim();
+        char* buffer = (frame != nullptr) ? frame->data : overflow;
+        int64_t rx_time;
+        int n = this->transport->receive(buffer, TRANSPORT_MSGLEN, (in_flight > 0) ? 0 : timeout, rx_time);
+        if (n < 0) {
+            std::cerr << "didn't get response from server?";
+            return true;
+        } else if (n > 0) {
+            idle = 0;
+            if (frame == nullptr) {
+                this->dropped_frames++;
+            } else {
+                frame->rx_time = rx_time;
+                frame->length = n;
+                this->frames.publish();
+                in_flight++;
+                if (strncmp(buffer, "***", 3) == 0) {
+                    ending = true;
+                } else if (this->frames_file != nullptr) {
+                    TelemetryEvent* event = this->claimEvent();
+                    if (event != nullptr) {
+                        event->kind = TelemetryEvent::FRAME;
+                        event->length = n;
+                        memcpy(event->data, buffer, n + 1);
+                        this->telemetry.publish();
+                    }
+                }
+            }
+        } else if (in_flight == 0) {
+            std::cout << "** Server did not respond in 1 second.\n";
+        }
+
+        if (!this->sendActions(in_flight, end)) return true;
+        if (in_flight > 0) relax(idle);
+    }
+
+    // The end of the episode is reported once the telemetry has caught up
+    TelemetryEvent* event;
+    while ((event = this->telemetry.claim()) == nullptr) std::this_thread::yield();
+    event->kind = (end.kind == PipelineAction::SHUTDOWN) ? TelemetryEvent::SHUTDOWN : TelemetryEvent::RESTART;
+    event->dropped = this->dropped_frames;
+    this->telemetry.publish();
+    while (!this->telemetry.empty()) std::this_thread::yield();
+
+    return (end.kind == PipelineAction::SHUTDOWN) && end.ready;
+}
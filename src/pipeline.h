@@ -0,0 +1,146 @@
+/**
+    pipeline.h
+    Client pipeline: network, control and telemetry threads
+
+    @author Antoine Passemiers
+    @version 1.0 13/08/2019
+*/
+
+#ifndef PIPELINE_H__
+#define PIPELINE_H__
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+#include "JerryTheRaceCarDriver.h"
+#include "flightlog.h"
+#include "latency.h"
+#include "spscring.h"
+#include "transport.h"
+
+
+// Message received by the network thread, for the control thread
+struct PipelineFrame {
+    int64_t rx_time;
+    int length;
+    char data[TRANSPORT_MSGLEN];
+};
+
+// Answer of the control thread to a message
+struct PipelineAction {
+    // What the answer is
+    typedef enum { ACTION, RESTART, SHUTDOWN } tKind;
+    tKind kind;
+
+    // Shutdowns: whether the driver is ready to stop racing
+    bool ready;
+
+    // Arrival time of the message being answered
+    int64_t rx_time;
+
+    // Simulation step, the input and output of the controller at this
+    // step, and their FLIGHT_RECORD_* flags (filled only when a flight
+    // log is recorded)
+    uint32_t step;
+    CarState state;
+    CarControl control;
+    uint32_t flags;
+
+    // Action message to be sent
+    int length;
+    char data[TRANSPORT_MSGLEN];
+};
+
+// Event to be handled by the telemetry thread
+struct TelemetryEvent {
+    typedef enum { FRAME, STEP, RESTART, SHUTDOWN } tKind;
+    tKind kind;
+
+    // Steps: arrival of the sensors and sending of the action
+    int64_t rx_time;
+    int64_t tx_time;
+    uint32_t episode;
+    uint32_t step;
+    CarState state;
+    CarControl control;
+    uint32_t flags;
+
+    // End of episode: number of messages dropped by the network thread
+    unsigned long dropped;
+
+    // Frames: received message, to be recorded
+    int length;
+    char data[TRANSPORT_MSGLEN];
+};
+
+
+/**
+    Runs the client as a pipeline of three threads. The network thread
+    (the caller of runEpisode) receives the messages and hands them to
+    the control thread, which decodes them, runs the driver and hands
+    back the actions to be sent. Recording and logging are left to a
+    telemetry thread. Threads only communicate through lock-free rings,
+    so that neither parsing nor logging delays the network thread.
+*/
+class Pipeline {
+private:
+    // Number of slots in the rings
+    static constexpr size_t FRAME_SLOTS = 16;
+    static constexpr size_t TELEMETRY_SLOTS = 256;
+
+    Transport* transport;
+    JerryTheRaceCarDriver &driver;
+    FlightLog* flight_log;
+    FILE* frames_file;
+
+    // Rings between the threads
+    SpscRing<PipelineFrame, FRAME_SLOTS> frames;
+    SpscRing<PipelineAction, FRAME_SLOTS> actions;
+    SpscRing<TelemetryEvent, TELEMETRY_SLOTS> telemetry;
+
+    // Control and telemetry threads
+    std::thread control_thread;
+    std::thread telemetry_thread;
+    std::atomic<bool> stop{false};
+
+    // Episode parameters, published to the control thread with the first frame
+    unsigned long episode = 0;
+    unsigned int max_steps = 0;
+
+    // Messages dropped because a ring was full
+    unsigned long dropped_frames = 0;
+    std::atomic<unsigned long> dropped_events{0};
+
+    // Telemetry thread state: latencies of the current episode
+    LatencyHistogram latency;
+    LatencyHistogram inter_arrival;
+    LatencyHistogram total_latency;
+
+    // Thread loops
+    void control();
+    void report();
+
+    // Hands an event to the telemetry thread, or drops it
+    TelemetryEvent* claimEvent();
+
+    // Sends the actions handed back by the control thread
+    bool sendActions(unsigned int &in_flight, PipelineAction &end);
+
+public:
+
+    // Constructor and destructor
+    Pipeline(Transport* transport, JerryTheRaceCarDriver &driver, FlightLog* flight_log, FILE* frames_file, int cpu);
+    ~Pipeline();
+
+    // Drives an episode, until the server restarts or shuts down the race
+    bool runEpisode(unsigned long episode, unsigned int max_steps, long timeout);
+
+    // Control thread and latencies of the finished episodes
+    std::thread::native_handle_type controlThread();
+    LatencyHistogram& totalLatency();
+};
+
+
+#endif // PIPELINE_H__
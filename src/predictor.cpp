@@ -0,0 +1,135 @@
+/**
+    predictor.cpp
+    Short-horizon extrapolation of the car state
+
+    @author Antoine Passemiers
+    @version 1.0 15/08/2019
+*/
+
+#include "predictor.h"
+
+#include <cmath>
+#include <cstring>
+
+
+/**
+    Brings an angle back between -pi and pi.
+
+    @param delta Angle (or difference of two angles) in [-2 pi, 2 pi].
+    @return Equivalent angle in [-pi, pi].
+*/
+static inline double wrapAngle(double delta) {
+    if (delta > M_PI) return delta - 2.0 * M_PI;
+    if (delta < -M_PI) return delta + 2.0 * M_PI;
+    return delta;
+}
+
+/**
+    Constructs a predictor with no history.
+
+    @param lead_ticks Number of simulation ticks to be added
+        to the measured client latency.
+*/
+StatePredictor::StatePredictor(double lead_ticks) : lead_ticks(lead_ticks) {
+    this->latency = 0.0;
+    this->frame_interval = 0.0;
+    std::memset(this->times, 0, sizeof(this->times));
+    std::memset(this->values, 0, sizeof(this->values));
+    this->reset();
+}
+
+/**
+    Forgets the past frames. The latency and frame interval
+    estimates are kept.
+*/
+void StatePredictor::reset() {
+    this->n_samples = 0;
+}
+
+/**
+    Records the time taken by the client to answer a frame.
+
+    @param elapsed Time between the arrival of a frame and
+        the action being ready, in nanoseconds.
+*/
+void StatePredictor::recordLatency(int64_t elapsed) {
+    double seconds = elapsed * 1e-9;
+    if (this->latency == 0.0) this->latency = seconds;
+    else this->latency += SMOOTHING * (seconds - this->latency);
+}
+
+/**
+    @return Time over which the car state is extrapolated, in seconds.
+*/
+double StatePredictor::horizon() const {
+    return this->latency + this->lead_ticks * this->frame_interval;
+}
+
+/**
+    Records a frame, and extrapolates the angle, the track position
+    and the speeds over the horizon. Velocities are taken from the
+    last two frames, accelerations from the last three. Nothing is
+    extrapolated until two frames have been recorded.
+
+    @param cs Car state decoded from the frame.
+    @param time Arrival time of the frame on the monotonic clock,
+        in nanoseconds.
+    @return The extrapolated car state.
+*/
+CarState& StatePredictor::predict(const CarState &cs, int64_t time) {
+    double t = time * 1e-9;
+
+    // Frames too far apart (e.g. after a pause) do not tell the dynamics
+    if (this->n_samples > 0) {
+        double gap = t - this->times[0];
+        if ((gap <= 0.0) || (gap > MAX_GAP)) {
+            this->n_samples = 0;
+        } else if (this->frame_interval == 0.0) {
+            this->frame_interval = gap;
+        } else {
+            this->frame_interval += SMOOTHING * (gap - this->frame_interval);
+        }
+    }
+
+    for (int i = HISTORY - 1; i > 0; i--) {
+        this->times[i] = this->times[i - 1];
+        for (int j = 0; j < N_VARIABLES; j++) this->values[i][j] = this->values[i - 1][j];
+    }
+    this->times[0] = t;
+    this->values[0][0] = cs.angle;
+    this->values[0][1] = cs.trackPos;
+    this->values[0][2] = cs.speedX;
+    this->values[0][3] = cs.speedY;
+    this->values[0][4] = cs.speedZ;
+    if (this->n_samples < HISTORY) this->n_samples++;
+
+    this->predicted = cs;
+    if (this->n_samples < 2) return this->predicted;
+
+    double h = this->horizon();
+    double inv_d1 = 1.0 / (this->times[0] - this->times[1]);
+    double inv_d12 = (this->n_samples > 2) ? 2.0 / (this->times[0] - this->times[2]) : 0.0;
+    double inv_d2 = (this->n_samples > 2) ? 1.0 / (this->times[1] - this->times[2]) : 0.0;
+    double extrapolated[N_VARIABLES];
+    for (int j = 0; j < N_VARIABLES; j++) {
+        double delta1 = this->values[0][j] - this->values[1][j];
+        double delta2 = this->values[1][j] - this->values[2][j];
+
+        // The angle wraps around at +/- pi
+        if (j == 0) {
+            delta1 = wrapAngle(delta1);
+            delta2 = wrapAngle(delta2);
+        }
+
+        double velocity = delta1 * inv_d1;
+        double acceleration = (velocity - delta2 * inv_d2) * inv_d12;
+        extrapolated[j] = this->values[0][j] + h * (velocity + 0.5 * h * acceleration);
+    }
+
+    this->predicted.angle = static_cast<float>(wrapAngle(extrapolated[0]));
+    this->predicted.trackPos = static_cast<float>(extrapolated[1]);
+    this->predicted.speedX = static_cast<float>(extrapolated[2]);
+    this->predicted.speedY = static_cast<float>(extrapolated[3]);
+    this->predicted.speedZ = static_cast<float>(extrapolated[4]);
+    return this->predicted;
+}
@@ -0,0 +1,77 @@
+/**
+    predictor.h
+    Short-horizon extrapolation of the car state
+
+    @author Antoine Passemiers
+    @version 1.0 15/08/2019
+*/
+
+#ifndef PREDICTOR_H__
+#define PREDICTOR_H__
+
+#include <cstdint>
+
+#include "carstate.h"
+
+
+/**
+    Compensates the delay between the sensing of a car state and the
+    application of the car controls computed from it. The angle, the
+    track position and the speeds are extrapolated over that delay,
+    with a second-order fit to the last three frames. The delay is the
+    measured client latency, plus a number of simulation ticks.
+*/
+class StatePredictor {
+private:
+    // Number of frames the extrapolation is fitted to
+    static constexpr int HISTORY = 3;
+
+    // Number of extrapolated variables: angle, trackPos, speedX, speedY, speedZ
+    static constexpr int N_VARIABLES = 5;
+
+    // Gap between frames (in seconds) beyond which the history is dropped
+    static constexpr double MAX_GAP = 0.5;
+
+    // Smoothing factor of the latency and frame interval estimates
+    static constexpr double SMOOTHING = 0.05;
+
+    // Last frames, most recent first: arrival times (in seconds) and variables
+    double times[HISTORY];
+    double values[HISTORY][N_VARIABLES];
+    int n_samples;
+
+    // Number of simulation ticks to be added to the latency
+    double lead_ticks;
+
+    // Moving averages of the client latency and of the time
+    // between frames (in seconds)
+    double latency;
+    double frame_interval;
+
+    // Extrapolated car state
+    CarState predicted;
+
+public:
+
+    // Constructor and destructor
+    StatePredictor(double lead_ticks);
+    ~StatePredictor() = default;
+
+    // Forgets the past frames (e.g. at a restart)
+    void reset();
+
+    // Records the time taken to answer a frame, in nanoseconds
+    void recordLatency(int64_t elapsed);
+
+    // Extrapolation horizon, in seconds
+    double horizon() const;
+
+    // Records a frame and extrapolates it
+    CarState& predict(const CarState &cs, int64_t time);
+
+    // Car state extrapolated from the last frame
+    const CarState& prediction() const { return this->predicted; }
+};
+
+
+#endif // PREDICTOR_H__
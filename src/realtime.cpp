@@ -0,0 +1,108 @@
+/**
+    realtime.cpp
+    Scheduling and memory settings for low-jitter driving
+
+    @author Antoine Passemiers
+    @version 1.0 14/08/2019
+*/
+
+#include "realtime.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+#include <alloca.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+
+/**
+    Pins a thread to a CPU core (Linux only).
+
+    @param thread Thread to be pinned.
+    @param cpu Index of the core.
+    @return Whether the thread could be pinned.
+*/
+bool pinThread(std::thread::native_handle_type thread, int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+#else
+    (void) thread;
+    (void) cpu;
+    return false;
+#endif
+}
+
+/**
+    Requests the SCHED_FIFO policy for a thread (Linux only). This
+    usually requires privileges (CAP_SYS_NICE or an RLIMIT_RTPRIO),
+    and the thread keeps its policy if the request is denied.
+
+    @param thread Thread to be scheduled.
+    @param priority Real-time priority, between 1 and 99.
+    @return Whether the policy was granted.
+*/
+bool requestFifoScheduling(std::thread::native_handle_type thread, int priority) {
+#ifdef __linux__
+    sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    return pthread_setschedparam(thread, SCHED_FIFO, &param) == 0;
+#else
+    (void) thread;
+    (void) priority;
+    return false;
+#endif
+}
+
+/**
+    Locks the current and future pages of the process in memory
+    (Linux only), so that the race does not page fault on memory
+    swapped out or not mapped yet. The allocator is also told to
+    never give memory back to the system, so that memory freed
+    after prefaulting stays mapped.
+
+    @return Whether the pages could be locked.
+*/
+bool lockMemory() {
+#ifdef __linux__
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    return mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+#else
+    return false;
+#endif
+}
+
+/**
+    Touches the pages of the stack and of the heap the race will use,
+    so that they are mapped before the first simulation step. Meant to
+    be called after lockMemory().
+
+    @param stack_size Number of bytes of stack to be touched.
+    @param heap_size Number of bytes of heap to be touched.
+*/
+void prefaultMemory(size_t stack_size, size_t heap_size) {
+#ifdef __linux__
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    volatile char* stack = static_cast<volatile char*>(alloca(stack_size));
+    for (size_t i = 0; i < stack_size; i += page) stack[i] = 0;
+
+    char* heap = static_cast<char*>(malloc(heap_size));
+    if (heap != nullptr) {
+        for (size_t i = 0; i < heap_size; i += page) reinterpret_cast<volatile char*>(heap)[i] = 0;
+        free(heap);
+    }
+#else
+    (void) stack_size;
+    (void) heap_size;
+#endif
+}
@@ -0,0 +1,38 @@
+/**
+    realtime.h
+    Scheduling and memory settings for low-jitter driving
+
+    @author Antoine Passemiers
+    @version 1.0 14/08/2019
+*/
+
+#ifndef REALTIME_H__
+#define REALTIME_H__
+
+#include <cstddef>
+#include <thread>
+
+
+// Default priority requested for the SCHED_FIFO policy
+#define REALTIME_FIFO_PRIORITY 50
+
+// Stack and heap sizes touched before the race
+#define REALTIME_PREFAULT_STACK (512 * 1024)
+#define REALTIME_PREFAULT_HEAP (8 * 1024 * 1024)
+
+
+// Pins a thread to a CPU core
+bool pinThread(std::thread::native_handle_type thread, int cpu);
+
+// Requests the SCHED_FIFO policy for a thread
+bool requestFifoScheduling(std::thread::native_handle_type thread, int priority);
+
+// Locks the current and future pages of the process in memory,
+// and keeps the freed heap memory mapped
+bool lockMemory();
+
+// Touches the stack and heap pages the race will use
+void prefaultMemory(size_t stack_size, size_t heap_size);
+
+
+#endif // REALTIME_H__
@@ -0,0 +1,235 @@
+/**
+    replay.cpp
+    Offline replay of a flight log through the controller
+
+    Pushes the car states recorded by the client (see its "log:"
+    option) through the controller as fast as possible, and compares
+    the car controls with the recorded ones. The recorded actions can
+    only be reproduced with the parameters they were computed with,
+    i.e. for a log recorded with a trained model (not in training mode).
+    Steps where the client sent the fallback action of a budget overrun
+    (see its "budget:" option) are replayed but not compared, and
+    are counted apart.
+
+    With the "accuracy" option, the car states are also pushed through
+    a single-precision and a double-precision controller, and the
+    differences between their controls are reported lap by lap.
+
+    @author Antoine Passemiers
+    @version 1.0 11/08/2019
+*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "driver.h"
+#include "flightlog.h"
+
+
+using namespace std;
+
+
+// Largest difference between replayed and recorded controls
+typedef struct
+{
+    double accel;
+    double brake;
+    double steer;
+    unsigned long gear;
+} tDivergence;
+
+// Differences between the controls of the float and double controllers
+// over a lap
+typedef struct
+{
+    unsigned long episode;
+    unsigned long lap;
+    unsigned long steps;
+    double maxAccel;
+    double maxBrake;
+    double maxSteer;
+    double sumAccel;
+    double sumBrake;
+    double sumSteer;
+    unsigned long gear;
+} tLapAccuracy;
+
+// Prevents the compiler from optimizing the replayed code away
+static volatile double sink;
+
+
+/*
+ * Pushes the recorded car states through a float and a double controller
+ * loaded with the same model, and prints the differences between their
+ * controls for each lap. A lap ends with the episode, or when the current
+ * lap time goes back to zero.
+ */
+static void reportAccuracy(const FlightRecord* records, size_t n, const char* modelPath)
+{
+    BasicController<float> single;
+    BasicController<double> reference;
+    single.setModelLocation(modelPath);
+    single.train(false);
+    reference.setModelLocation(modelPath);
+    reference.train(false);
+
+    vector<tLapAccuracy> laps;
+    for (size_t i = 0; i < n; i++)
+    {
+        const CarState &recorded = records[i].state;
+        bool newEpisode = (i == 0) || (records[i].episode != records[i - 1].episode);
+        bool newLap = !newEpisode && (recorded.curLapTime < records[i - 1].state.curLapTime);
+        if (newEpisode || newLap)
+        {
+            tLapAccuracy lap = { records[i].episode, newLap ? laps.back().lap + 1 : 0, 0,
+                                 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0 };
+            laps.push_back(lap);
+        }
+
+        CarState cs = recorded;
+        CarControl a = single.control(cs);
+        cs = recorded;
+        CarControl b = reference.control(cs);
+        double accel = fabs(a.accel - b.accel);
+        double brake = fabs(a.brake - b.brake);
+        double steer = fabs(a.steer - b.steer);
+        tLapAccuracy &lap = laps.back();
+        lap.steps++;
+        lap.maxAccel = max(lap.maxAccel, accel);
+        lap.maxBrake = max(lap.maxBrake, brake);
+        lap.maxSteer = max(lap.maxSteer, steer);
+        lap.sumAccel += accel;
+        lap.sumBrake += brake;
+        lap.sumSteer += steer;
+        lap.gear += (a.gear != b.gear);
+    }
+
+    cout << "Accuracy of float against double controls (max / mean absolute difference):" << endl;
+    printf("%8s %4s %7s %21s %21s %21s %6s\n", "episode", "lap", "steps", "accel", "brake", "steer", "gear");
+    for (size_t i = 0; i < laps.size(); i++)
+    {
+        const tLapAccuracy &lap = laps[i];
+        printf("%8lu %4lu %7lu %10.3g / %-8.3g %10.3g / %-8.3g %10.3g / %-8.3g %6lu\n",
+               lap.episode, lap.lap, lap.steps,
+               lap.maxAccel, lap.sumAccel / lap.steps, lap.maxBrake, lap.sumBrake / lap.steps,
+               lap.maxSteer, lap.sumSteer / lap.steps, lap.gear);
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    char logPath[1000] = "";
+    char modelPath[1000] = "";
+    double tolerance = 1e-4;
+    double minSeconds = 1.0;
+    bool accuracy = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "log:", 4) == 0)
+            sscanf(argv[i], "log:%s", logPath);
+        else if (strncmp(argv[i], "model:", 6) == 0)
+            sscanf(argv[i], "model:%s", modelPath);
+        else if (strncmp(argv[i], "tolerance:", 10) == 0)
+            sscanf(argv[i], "tolerance:%lf", &tolerance);
+        else if (strncmp(argv[i], "time:", 5) == 0)
+            sscanf(argv[i], "time:%lf", &minSeconds);
+        else if (strcmp(argv[i], "accuracy") == 0)
+            accuracy = true;
+    }
+
+    FlightLogReader log;
+    if (!log.open(logPath))
+    {
+        cerr << "cannot read flight log " << logPath << endl;
+        return 1;
+    }
+    if (log.size() == 0)
+    {
+        cerr << "empty flight log " << logPath << endl;
+        return 1;
+    }
+    const FlightRecord* records = log.records();
+
+    Controller controller;
+    if (modelPath[0] != '\0')
+    {
+        controller.setModelLocation(modelPath);
+        controller.train(false);
+    }
+    else
+        cout << "No model given: the controls are not expected to match" << endl;
+
+    // Divergence from the recorded actions
+    tDivergence maxDiff = { 0.0, 0.0, 0.0, 0 };
+    unsigned long nDivergent = 0;
+    unsigned long nFallback = 0;
+    long firstDivergent = -1;
+    for (size_t i = 0; i < log.size(); i++)
+    {
+        CarState cs = records[i].state;
+        CarControl cc = controller.control(cs);
+        if (records[i].flags & FLIGHT_RECORD_FALLBACK)
+        {
+            nFallback++;
+            continue;
+        }
+        const CarControl &recorded = records[i].action;
+        double accel = fabs(cc.accel - recorded.accel);
+        double brake = fabs(cc.brake - recorded.brake);
+        double steer = fabs(cc.steer - recorded.steer);
+        bool gear = (cc.gear != recorded.gear);
+        maxDiff.accel = max(maxDiff.accel, accel);
+        maxDiff.brake = max(maxDiff.brake, brake);
+        maxDiff.steer = max(maxDiff.steer, steer);
+        maxDiff.gear += gear;
+        if ((accel > tolerance) || (brake > tolerance) || (steer > tolerance) || gear)
+        {
+            nDivergent++;
+            if (firstDivergent < 0)
+                firstDivergent = i;
+        }
+    }
+
+    // Throughput, over as many passes as needed to last minSeconds
+    unsigned long nSteps = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    double elapsed = 0.0;
+    do
+    {
+        for (size_t i = 0; i < log.size(); i++)
+        {
+            CarState cs = records[i].state;
+            sink = controller.control(cs).steer;
+        }
+        nSteps += log.size();
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (elapsed < minSeconds);
+
+    unsigned long nEpisodes = records[log.size() - 1].episode - records[0].episode + 1;
+    cout << "Records: " << log.size() << " over " << nEpisodes << " episode(s)" << endl;
+    cout << "Throughput: " << nSteps / elapsed << " steps/s (" << elapsed * 1e9 / nSteps << " ns/step)" << endl;
+    cout << "Divergent steps: " << nDivergent << " (tolerance " << tolerance << ")" << endl;
+    if (nFallback > 0)
+        cout << "Fallback steps (budget overruns, not compared): " << nFallback << endl;
+    if (firstDivergent >= 0)
+        cout << "First divergence: episode " << records[firstDivergent].episode
+             << ", step " << records[firstDivergent].step << endl;
+    cout << "Max difference: accel " << maxDiff.accel << ", brake " << maxDiff.brake
+         << ", steer " << maxDiff.steer << ", gear mismatches " << maxDiff.gear << endl;
+
+    if (accuracy)
+    {
+        if (modelPath[0] == '\0')
+            cerr << "The accuracy report needs a model" << endl;
+        else
+            reportAccuracy(records, log.size(), modelPath);
+    }
+    return (nDivergent > 0) ? 2 : 0;
+}
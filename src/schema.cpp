@@ -0,0 +1,246 @@
+/**
+    schema.cpp
+    Compile-time description of the messages exchanged with the server
+
+    @author Antoine Passemiers
+    @version 1.0 06/08/2019
+*/
+
+#include "schema.h"
+
+
+/**
+    Fills the selected fields of a message. The buffer is walked only
+    once: each "(tag values...)" group is matched against the schema and,
+    if the field is selected by the mask, its values are read in place.
+    Other fields are only located. Only the first occurrence of a tag
+    is taken into account.
+
+    @param fields Message fields.
+    @param n_fields Number of fields.
+    @param slots Perfect hash table of the schema.
+    @param table_size Number of slots in the hash table.
+    @param seed Seed of the hash function.
+    @param buffer Message buffer (not necessarily null-terminated).
+    @param length Number of characters in the buffer.
+    @param message Structure to be filled.
+    @param mask Fields to be decoded.
+    @return Number of fields found in the buffer.
+*/
+int codec::decode(const Field* fields, size_t n_fields, const signed char* slots, size_t table_size,
+                  unsigned int seed, const char* buffer, size_t length, void* message, unsigned int mask) {
+    const char* end = buffer + length;
+    char* base = static_cast<char*>(message);
+    unsigned int found = 0;
+    int n_found = 0;
+
+    const char* open = static_cast<const char*>(std::memchr(buffer, '(', length));
+    while (open != nullptr) {
+        const char* close = static_cast<const char*>(std::memchr(open, ')', end - open));
+        if (close == nullptr) break;
+
+        // Tag is the first word inside the parentheses
+        const char* tag = SimpleParser::skipSpaces(open + 1, close);
+        const char* p = tag;
+        while ((p != close) && !SimpleParser::isSpace(*p)) p++;
+
+        int k = findField(fields, slots, table_size, seed, tag, p - tag);
+        if ((k >= 0) && !(found & (1u << k))) {
+            found |= (1u << k);
+            n_found++;
+        }
+
+        // Values are read only for the selected fields,
+        // other fields are merely located
+        if ((k >= 0) && (mask & (1u << k))) {
+            const Field& field = fields[k];
+            mask &= ~(1u << k);
+            if (field.type == FIELD_INT) {
+                SimpleParser::scan(p, close, *reinterpret_cast<int*>(base + field.offset));
+            } else {
+                float* values = reinterpret_cast<float*>(base + field.offset);
+                for (int i = 0; (i < field.size) && (p != nullptr); i++) {
+                    p = SimpleParser::scan(p, close, values[i]);
+                }
+            }
+        }
+
+        open = static_cast<const char*>(std::memchr(close, '(', end - close));
+    }
+    return n_found;
+}
+
+/**
+    Appends all the fields of a message to a string,
+    in schema order.
+
+    @param fields Message fields.
+    @param n_fields Number of fields.
+    @param message Structure to be encoded.
+    @param str String to which the fields are appended.
+*/
+void codec::encode(const Field* fields, size_t n_fields, const void* message, std::string &str) {
+    const char* base = static_cast<const char*>(message);
+    ostringstream STR;
+    for (size_t k = 0; k < n_fields; k++) {
+        const Field& field = fields[k];
+        STR << "(" << field.tag;
+        if (field.type == FIELD_INT) {
+            STR << " " << *reinterpret_cast<const int*>(base + field.offset);
+        } else {
+            const float* values = reinterpret_cast<const float*>(base + field.offset);
+            for (int i = 0; i < field.size; i++) {
+                STR << " " << values[i];
+            }
+        }
+        STR << ")";
+    }
+    str += STR.str();
+}
+
+/**
+    Writes all the fields of a message into a buffer, in schema
+    order, with the same formatting as the string encoder.
+    No memory is allocated.
+
+    @param fields Message fields.
+    @param n_fields Number of fields.
+    @param message Structure to be encoded.
+    @param buffer Destination buffer.
+    @param size Capacity of the buffer.
+    @return Length of the message (excluding the terminating null
+        character), or 0 if the message does not fit in the buffer.
+*/
+size_t codec::encode(const Field* fields, size_t n_fields, const void* message, char* buffer, size_t size) {
+    if (size == 0) return 0;
+    const char* base = static_cast<const char*>(message);
+    char* p = buffer;
+    char* last = buffer + size - 1; // Keep room for the null character
+
+    for (size_t k = 0; (k < n_fields) && (p != nullptr); k++) {
+        const Field& field = fields[k];
+        if (static_cast<size_t>(last - p) < field.tag_length + 1) {
+            p = nullptr;
+            break;
+        }
+        *p++ = '(';
+        std::memcpy(p, field.tag, field.tag_length);
+        p += field.tag_length;
+        for (int i = 0; (i < field.size) && (p != nullptr); i++) {
+            if (p == last) {
+                p = nullptr;
+                break;
+            }
+            *p++ = ' ';
+            if (field.type == FIELD_INT) {
+                p = SimpleParser::format(p, last, reinterpret_cast<const int*>(base + field.offset)[i]);
+            } else {
+                p = SimpleParser::format(p, last, reinterpret_cast<const float*>(base + field.offset)[i]);
+            }
+        }
+        if ((p == nullptr) || (p == last)) {
+            p = nullptr;
+            break;
+        }
+        *p++ = ')';
+    }
+
+    if (p == nullptr) {
+        buffer[0] = '\0';
+        return 0;
+    }
+    *p = '\0';
+    return p - buffer;
+}
+
+/**
+    Fills the selected fields of a message from a binary frame. A frame
+    with another version or with another number of fields is rejected.
+
+    @param fields Message fields.
+    @param n_fields Number of fields.
+    @param buffer Frame buffer.
+    @param length Number of bytes in the buffer.
+    @param message Structure to be filled.
+    @param mask Fields to be decoded.
+    @return Number of fields found in the frame (0 if it is rejected).
+*/
+int codec::decodeBinary(const Field* fields, size_t n_fields, const char* buffer, size_t length,
+                        void* message, unsigned int mask) {
+    static_assert((sizeof(float) == 4) && (sizeof(int) == 4), "Binary frames carry 32-bit values");
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(buffer);
+    char* base = static_cast<char*>(message);
+
+    size_t expected = BINARY_HEADER_SIZE;
+    for (size_t k = 0; k < n_fields; k++) {
+        expected += 4 * fields[k].size;
+    }
+    if ((length < expected) || (p[0] != BINARY_FRAME_MAGIC) || (p[1] != BINARY_FRAME_VERSION)
+            || (p[2] != n_fields)) {
+        return 0;
+    }
+
+    p += BINARY_HEADER_SIZE;
+    for (size_t k = 0; k < n_fields; k++) {
+        const Field& field = fields[k];
+        if (mask & (1u << k)) {
+            char* dst = base + field.offset;
+            for (int i = 0; i < field.size; i++) {
+                uint32_t bits = static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+                    | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+                std::memcpy(dst + 4 * i, &bits, 4);
+                p += 4;
+            }
+        } else {
+            p += 4 * field.size;
+        }
+    }
+    return static_cast<int>(n_fields);
+}
+
+/**
+    Writes all the fields of a message as a binary frame, in schema
+    order. No memory is allocated.
+
+    @param fields Message fields.
+    @param n_fields Number of fields.
+    @param message Structure to be encoded.
+    @param buffer Destination buffer.
+    @param size Capacity of the buffer.
+    @return Length of the frame (excluding the terminating null
+        byte), or 0 if the frame does not fit in the buffer.
+*/
+size_t codec::encodeBinary(const Field* fields, size_t n_fields, const void* message, char* buffer, size_t size) {
+    const char* base = static_cast<const char*>(message);
+    unsigned char* p = reinterpret_cast<unsigned char*>(buffer);
+
+    size_t length = BINARY_HEADER_SIZE;
+    for (size_t k = 0; k < n_fields; k++) {
+        length += 4 * fields[k].size;
+    }
+    if (length >= size) {
+        if (size > 0) buffer[0] = '\0';
+        return 0;
+    }
+
+    p[0] = BINARY_FRAME_MAGIC;
+    p[1] = BINARY_FRAME_VERSION;
+    p[2] = static_cast<unsigned char>(n_fields);
+    p[3] = 0;
+    p += BINARY_HEADER_SIZE;
+    for (size_t k = 0; k < n_fields; k++) {
+        const Field& field = fields[k];
+        const char* src = base + field.offset;
+        for (int i = 0; i < field.size; i++) {
+            uint32_t bits;
+            std::memcpy(&bits, src + 4 * i, 4);
+            p[0] = static_cast<unsigned char>(bits);
+            p[1] = static_cast<unsigned char>(bits >> 8);
+            p[2] = static_cast<unsigned char>(bits >> 16);
+            p[3] = static_cast<unsigned char>(bits >> 24);
+            p += 4;
+        }
+    }
+    *p = '\0';
+    return length;
+}
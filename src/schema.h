@@ -0,0 +1,289 @@
+/**
+    schema.h
+    Compile-time description of the messages exchanged with the server
+
+    @author Antoine Passemiers
+    @version 1.0 06/08/2019
+*/
+
+#ifndef SCHEMA_H__
+#define SCHEMA_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "SimpleParser.h"
+
+
+// Types of values carried by a field
+#define FIELD_FLOAT 0
+#define FIELD_INT   1
+
+// Binary frames: 4-byte header (magic byte, version, number of fields,
+// reserved), then all the values of the fields in schema order, each as
+// a 32-bit little-endian word (IEEE 754 floats, two's complement ints)
+#define BINARY_FRAME_MAGIC   0xB5
+#define BINARY_FRAME_VERSION 1
+#define BINARY_HEADER_SIZE   4
+
+
+// Description of a message field: tag, location in the message
+// structure, type and number of values
+struct Field {
+    const char* tag;
+    size_t tag_length;
+    size_t offset;
+    short type;
+    int size;
+};
+
+
+// Field type and arity deduced from the type of a structure member
+// (the codecs read and write 32-bit floats and ints only)
+template <typename T>
+constexpr short fieldType() {
+    static_assert(std::is_same<std::remove_extent_t<T>, float>::value
+                  || std::is_same<std::remove_extent_t<T>, int>::value,
+                  "Schema fields must be float or int, or arrays of them");
+    return std::is_same<std::remove_extent_t<T>, int>::value ? FIELD_INT : FIELD_FLOAT;
+}
+
+template <typename T>
+constexpr int fieldArity() {
+    return std::is_array<T>::value ? static_cast<int>(std::extent<T>::value) : 1;
+}
+
+// Declares a field whose tag is the name of the structure member
+#define SCHEMA_FIELD(Message, member) \
+    Field { #member, sizeof(#member) - 1, offsetof(Message, member), \
+        fieldType<decltype(Message::member)>(), fieldArity<decltype(Message::member)>() }
+
+
+/**
+    Seeded FNV-1a hash of a tag.
+
+    @param tag First character of the tag.
+    @param length Number of characters in the tag.
+    @param seed Seed of the hash function.
+    @return Hash value.
+*/
+constexpr unsigned int hashTag(const char* tag, size_t length, unsigned int seed) {
+    unsigned int h = 2166136261u ^ seed;
+    for (size_t i = 0; i < length; i++) {
+        h ^= static_cast<unsigned char>(tag[i]);
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+
+/**
+    Looks up a tag in a perfect hash table.
+
+    @param fields Message fields.
+    @param slots Field index for each slot of the table.
+    @param table_size Number of slots (power of 2).
+    @param seed Seed of the hash function.
+    @param tag First character of the tag.
+    @param length Number of characters in the tag.
+    @return Index of the field, or -1 if unknown.
+*/
+constexpr int findField(const Field* fields, const signed char* slots, size_t table_size,
+                        unsigned int seed, const char* tag, size_t length) {
+    int k = slots[hashTag(tag, length, seed) & (table_size - 1)];
+    if ((k < 0) || (fields[k].tag_length != length)) return -1;
+    for (size_t i = 0; i < length; i++) {
+        if (fields[k].tag[i] != tag[i]) return -1;
+    }
+    return k;
+}
+
+
+/**
+    Message schema: the ordered list of fields, together with a
+    perfect hash table mapping each tag to its field. The table
+    is computed at compile time from the list of fields.
+*/
+template <size_t N>
+struct Schema {
+
+    // Size of the hash table (power of 2, at least 4 slots per field)
+    static constexpr size_t TABLE_SIZE = (N <= 4) ? 16 : (N <= 8) ? 32 : (N <= 16) ? 64 : 128;
+
+    // Number of fields
+    static constexpr size_t size = N;
+
+    // Fields, in serialization order
+    Field fields[N];
+
+    // Seed for which the hash function has no collision
+    unsigned int seed;
+
+    // Field index for each slot of the hash table (-1 if empty)
+    signed char slots[TABLE_SIZE];
+
+    /**
+        Looks up a tag in the hash table.
+
+        @param tag First character of the tag.
+        @param length Number of characters in the tag.
+        @return Index of the field, or -1 if unknown.
+    */
+    constexpr int find(const char* tag, size_t length) const {
+        return findField(this->fields, this->slots, TABLE_SIZE, this->seed, tag, length);
+    }
+};
+
+
+/**
+    Bit mask selecting a single field of a schema.
+    Fails at compile time if the tag is unknown.
+
+    @param schema Message schema.
+    @param tag Tag of the field.
+    @return Bit mask of the field.
+*/
+template <size_t N, size_t L>
+constexpr unsigned int fieldMask(const Schema<N> &schema, const char (&tag)[L]) {
+    int k = schema.find(tag, L - 1);
+    if (k < 0) throw "Unknown tag";
+    return 1u << k;
+}
+
+
+/**
+    Builds a schema from a list of fields, searching for a seed
+    that makes the tag hash function collision-free.
+
+    @param fields Message fields, in serialization order.
+    @return Schema with its perfect hash table.
+*/
+template <size_t N>
+constexpr Schema<N> makeSchema(const Field (&fields)[N]) {
+    static_assert(N <= 32, "Field masks are limited to 32 fields");
+    Schema<N> schema {};
+    for (size_t i = 0; i < N; i++) schema.fields[i] = fields[i];
+    for (unsigned int seed = 0; seed < 100000; seed++) {
+        bool collision = false;
+        for (size_t j = 0; j < Schema<N>::TABLE_SIZE; j++) schema.slots[j] = -1;
+        for (size_t i = 0; (i < N) && !collision; i++) {
+            size_t h = hashTag(fields[i].tag, fields[i].tag_length, seed) & (Schema<N>::TABLE_SIZE - 1);
+            if (schema.slots[h] >= 0) {
+                collision = true;
+            } else {
+                schema.slots[h] = static_cast<signed char>(i);
+            }
+        }
+        if (!collision) {
+            schema.seed = seed;
+            return schema;
+        }
+    }
+    throw "No perfect hash found for the schema";
+}
+
+
+// Generic codec working on any message structure described by a schema
+namespace codec {
+
+    // Mask selecting all the fields of a message
+    constexpr unsigned int ALL_FIELDS = ~0u;
+
+    // Fills the selected fields of a message, walking the buffer once
+    int decode(const Field* fields, size_t n_fields, const signed char* slots, size_t table_size,
+               unsigned int seed, const char* buffer, size_t length, void* message, unsigned int mask);
+
+    // Appends all the fields of a message to a string
+    void encode(const Field* fields, size_t n_fields, const void* message, std::string &str);
+
+    // Writes all the fields of a message into a buffer
+    size_t encode(const Field* fields, size_t n_fields, const void* message, char* buffer, size_t size);
+
+    // Fills the selected fields of a message from a binary frame
+    int decodeBinary(const Field* fields, size_t n_fields, const char* buffer, size_t length,
+                     void* message, unsigned int mask);
+
+    // Writes all the fields of a message as a binary frame
+    size_t encodeBinary(const Field* fields, size_t n_fields, const void* message, char* buffer, size_t size);
+
+    /**
+        Whether a message is a binary frame rather than text.
+
+        @param buffer Message buffer.
+        @param length Number of bytes in the buffer.
+        @return Whether the message starts with a binary frame header.
+    */
+    inline bool isBinary(const char* buffer, size_t length) {
+        return (length >= BINARY_HEADER_SIZE) && (static_cast<unsigned char>(buffer[0]) == BINARY_FRAME_MAGIC);
+    }
+
+    /**
+        Decodes a message, text or binary frame, leaving the fields that
+        are missing from the buffer or not selected by the mask unchanged.
+
+        @param schema Message schema.
+        @param buffer Message buffer (not necessarily null-terminated).
+        @param length Number of characters in the buffer.
+        @param message Structure to be filled.
+        @param mask Fields to be decoded (see fieldMask).
+        @return Number of fields found in the buffer.
+    */
+    template <size_t N, typename Message>
+    int decode(const Schema<N> &schema, const char* buffer, size_t length, Message &message,
+               unsigned int mask = ALL_FIELDS) {
+        if (isBinary(buffer, length)) {
+            return decodeBinary(schema.fields, N, buffer, length, &message, mask);
+        }
+        return decode(schema.fields, N, schema.slots, Schema<N>::TABLE_SIZE, schema.seed,
+                      buffer, length, &message, mask);
+    }
+
+    /**
+        Encodes a message as a sequence of "(tag values...)" groups.
+
+        @param schema Message schema.
+        @param message Structure to be encoded.
+        @return String message.
+    */
+    template <size_t N, typename Message>
+    std::string encode(const Schema<N> &schema, const Message &message) {
+        std::string str;
+        encode(schema.fields, N, &message, str);
+        return str;
+    }
+
+    /**
+        Encodes a message into a caller-provided buffer, without allocating.
+
+        @param schema Message schema.
+        @param message Structure to be encoded.
+        @param buffer Destination buffer.
+        @param size Capacity of the buffer.
+        @return Length of the null-terminated message, or 0 if it does not fit.
+    */
+    template <size_t N, typename Message>
+    size_t encode(const Schema<N> &schema, const Message &message, char* buffer, size_t size) {
+        return encode(schema.fields, N, &message, buffer, size);
+    }
+
+    /**
+        Encodes a message as a binary frame into a caller-provided
+        buffer, without allocating.
+
+        @param schema Message schema.
+        @param message Structure to be encoded.
+        @param buffer Destination buffer.
+        @param size Capacity of the buffer.
+        @return Length of the frame, or 0 if it does not fit. The frame
+            is followed by a null byte, as text messages are.
+    */
+    template <size_t N, typename Message>
+    size_t encodeBinary(const Schema<N> &schema, const Message &message, char* buffer, size_t size) {
+        return encodeBinary(schema.fields, N, &message, buffer, size);
+    }
+}
+
+#endif // SCHEMA_H__
@@ -0,0 +1,311 @@
+/**
+    scrserver.cpp
+    Stand-in for the SCR server, for load testing the client (Linux only)
+
+    Speaks the same protocol as the patched TORCS server: waits
+    for the "(init ...)" string, answers "***identified***", then
+    sends one sensor string per simulation step and waits for the
+    action. Episodes end with "***restart***" (after a given number of
+    steps, or when the client requests a restart) and the last one
+    with "***shutdown***". Sensor strings are replayed from a recorded
+    corpus, or synthesized. Binary frames are used instead of text when
+    the client offers them in its init string.
+
+    Like the simulator, one message is read per step and taken as the
+    action, whatever it is: an init string resent by the client while
+    the server was restarting, or a reply that missed its step, shifts
+    the actions of the following steps. Such messages are counted. The
+    time the simulator takes to restart can be given, during which the
+    messages of the client pile up.
+
+    Steps are either paced at a fixed rate, like the simulator, or
+    sent as soon as the client answers the previous one. Besides UDP,
+    the client can be reached through the other transports of the
+    client (see transport.h).
+
+    @author Antoine Passemiers
+    @version 1.0 10/08/2019
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "carcontrol.h"
+#include "carstate.h"
+#include "frames.h"
+#include "latency.h"
+#include "transport.h"
+
+/*** defines for UDP *****/
+#define UDP_MSGLEN 1000
+#define UDP_CLIENT_TIMEUOT 1000000
+#define UDP_IDENTIFY_TIMEOUT 10000000
+/************************/
+
+using namespace std;
+
+typedef chrono::steady_clock tClock;
+
+// Command line options
+typedef struct
+{
+    unsigned int port;
+    char transport[1000];
+    char framesPath[1000];
+    unsigned int maxEpisodes;
+    unsigned int maxSteps;
+    double rate;
+    long restartDelay;
+} tOptions;
+
+// Statistics over the whole run
+typedef struct
+{
+    unsigned long steps;
+    unsigned long episodes;
+    unsigned long missed;
+    unsigned long garbled;
+    unsigned long restartRequests;
+    LatencyHistogram latency;
+    LatencyHistogram identification;
+} tStats;
+
+
+void parse_args(int argc, char *argv[], tOptions &options);
+
+/**
+    Waits for a message until a deadline.
+
+    @return Number of bytes read, or -1 if the deadline has passed.
+*/
+int receive(Transport* transport, char *buf, tClock::time_point deadline)
+{
+    while (true)
+    {
+        tClock::duration remaining = deadline - tClock::now();
+        if (remaining <= tClock::duration::zero())
+            return -1;
+        int64_t rxTime;
+        long timeout = (long) chrono::ceil<chrono::microseconds>(remaining).count();
+        int numRead = transport->receive(buf, UDP_MSGLEN, timeout, rxTime);
+        if (numRead > 0)
+            return numRead;
+    }
+}
+
+/**
+    Sends a null-terminated message to the client.
+*/
+void reply(Transport* transport, const char *message, size_t length)
+{
+    if (!transport->send(message, length + 1))
+        cerr << "cannot send data to the client\n";
+}
+
+/**
+    Runs an episode: sends the sensor strings one step at a time
+    and collects the actions of the client.
+
+    @param cursor Index of the next sensor string in the corpus.
+    @return Whether the client is still there.
+*/
+bool runEpisode(Transport* transport, const vector<string> &frames, size_t &cursor,
+                const tOptions &options, tStats &stats)
+{
+    static char buf[UDP_MSGLEN];
+    const unsigned int metaMask = fieldMask(CAR_CONTROL_SCHEMA, "meta");
+    tClock::duration period = chrono::duration_cast<tClock::duration>(
+        chrono::duration<double>((options.rate > 0.0) ? 1.0 / options.rate : 0.0));
+    tClock::time_point nextStep = tClock::now();
+
+    for (unsigned int step = 0; (options.maxSteps == 0) || (step < options.maxSteps); step++)
+    {
+        const string &frame = frames[cursor];
+        cursor = (cursor + 1) % frames.size();
+        tClock::time_point sent = tClock::now();
+        reply(transport, frame.c_str(), frame.size());
+        stats.steps++;
+
+        // Like the simulator, do not wait beyond the next step
+        tClock::time_point deadline = sent + chrono::microseconds(UDP_CLIENT_TIMEUOT);
+        if (options.rate > 0.0)
+            deadline = nextStep + period;
+
+        int numRead = receive(transport, buf, deadline);
+        if (numRead < 0)
+        {
+            stats.missed++;
+            if (options.rate <= 0.0)
+                return false; // The client is gone
+        }
+        else
+        {
+            stats.latency.record(chrono::duration_cast<chrono::nanoseconds>(tClock::now() - sent).count());
+
+            // The message is the action of this step, even if it is not one
+            if ((buf[0] != '(') && !codec::isBinary(buf, numRead))
+                stats.garbled++;
+
+            // Restart requested by the client
+            CarControl cc;
+            cc.meta = 0;
+            codec::decode(CAR_CONTROL_SCHEMA, buf, numRead, cc, metaMask);
+            if (cc.meta == CarControl::META_RESTART)
+            {
+                stats.restartRequests++;
+                break;
+            }
+        }
+
+        if (options.rate > 0.0)
+        {
+            nextStep += period;
+            this_thread::sleep_until(nextStep);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    tOptions options;
+    parse_args(argc, argv, options);
+
+    vector<string> frames;
+    if (options.framesPath[0] != '\0')
+    {
+        if (!loadFrames(options.framesPath, frames))
+        {
+            cerr << "cannot read frames from " << options.framesPath << endl;
+            exit(1);
+        }
+    }
+    else
+        synthesizeFrames(2000, frames);
+
+    // The same frames, for the clients that accept binary frames
+    vector<string> binaryFrames;
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        char frame[UDP_MSGLEN];
+        size_t length = CarState(frames[i]).encodeBinary(frame, UDP_MSGLEN);
+        binaryFrames.push_back(string(frame, length));
+    }
+    string binaryOffer = "(binary " + to_string(BINARY_FRAME_VERSION) + ")";
+
+    Transport* transport = openTransport(options.transport, "localhost", options.port, true);
+    if (transport == NULL)
+        exit(1);
+
+    cout << "***********************************" << endl;
+    cout << "TRANSPORT: " << transport->name() << endl;
+    cout << "FRAMES: " << frames.size() << ((options.framesPath[0] != '\0') ? " recorded" : " synthetic") << endl;
+    cout << "MAX_STEPS: " << options.maxSteps << endl;
+    cout << "MAX_EPISODES: " << options.maxEpisodes << endl;
+    if (options.rate > 0.0)
+        cout << "RATE: " << options.rate << " steps/s" << endl;
+    else
+        cout << "RATE: as fast as the client answers" << endl;
+    cout << "***********************************" << endl;
+
+    tStats stats;
+    stats.steps = stats.episodes = stats.missed = stats.garbled = stats.restartRequests = 0;
+
+    char buf[UDP_MSGLEN];
+    size_t cursor = 0;
+    bool connected = true;
+    tClock::time_point start;
+    tClock::time_point restarted;
+    while (connected && ((options.maxEpisodes == 0) || (stats.episodes < options.maxEpisodes)))
+    {
+        // Identification: the client sends "ID(init angles...)"
+        tClock::time_point deadline = tClock::now() + chrono::microseconds(UDP_IDENTIFY_TIMEOUT);
+        int numRead;
+        while (((numRead = receive(transport, buf, deadline)) >= 0)
+               && (strstr(buf, "(init") == NULL));
+        if (numRead < 0)
+        {
+            cerr << "no client identified\n";
+            break;
+        }
+        if (stats.episodes == 0)
+            start = tClock::now();
+        else
+            stats.identification.record(chrono::duration_cast<chrono::nanoseconds>(tClock::now() - restarted).count());
+        bool binary = (strstr(buf, binaryOffer.c_str()) != NULL);
+        if (binary)
+        {
+            string answer = "***identified***" + binaryOffer;
+            reply(transport, answer.c_str(), answer.size());
+        }
+        else
+            reply(transport, "***identified***", 16);
+        if (stats.episodes == 0)
+            cout << "Frames: " << (binary ? "binary" : "text") << endl;
+
+        connected = runEpisode(transport, binary ? binaryFrames : frames, cursor, options, stats);
+        stats.episodes++;
+
+        if ((options.maxEpisodes != 0) && (stats.episodes == options.maxEpisodes))
+            reply(transport, "***shutdown***", 14);
+        else
+        {
+            reply(transport, "***restart***", 13);
+
+            // Messages sent by the client while the simulator
+            // restarts are read afterwards
+            if (connected && (options.restartDelay > 0))
+                this_thread::sleep_for(chrono::milliseconds(options.restartDelay));
+        }
+        restarted = tClock::now();
+    }
+
+    if (stats.episodes > 0)
+    {
+        double elapsed = chrono::duration<double>(tClock::now() - start).count();
+        cout << "Episodes: " << stats.episodes << " (" << stats.restartRequests << " restarted by the client), "
+             << stats.episodes / elapsed * 3600.0 << " episodes/hour" << endl;
+        cout << "Steps: " << stats.steps << ", " << stats.steps / elapsed << " steps/s" << endl;
+        cout << "Missed replies: " << stats.missed << ", replies other than actions: " << stats.garbled << endl;
+        stats.latency.report(cout, "Response latency");
+        stats.identification.report(cout, "Re-identification");
+    }
+    delete transport;
+    return 0;
+}
+
+void parse_args(int argc, char *argv[], tOptions &options)
+{
+    // Set default values
+    options.port = 3001;
+    strcpy(options.transport, "udp");
+    strcpy(options.framesPath, "");
+    options.maxEpisodes = 1;
+    options.maxSteps = 10000;
+    options.rate = 0.0;
+    options.restartDelay = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "port:", 5) == 0)
+            sscanf(argv[i], "port:%u", &options.port);
+        else if (strncmp(argv[i], "transport:", 10) == 0)
+            sscanf(argv[i], "transport:%s", options.transport);
+        else if (strncmp(argv[i], "frames:", 7) == 0)
+            sscanf(argv[i], "frames:%s", options.framesPath);
+        else if (strncmp(argv[i], "maxEpisodes:", 12) == 0)
+            sscanf(argv[i], "maxEpisodes:%u", &options.maxEpisodes);
+        else if (strncmp(argv[i], "maxSteps:", 9) == 0)
+            sscanf(argv[i], "maxSteps:%u", &options.maxSteps);
+        else if (strncmp(argv[i], "rate:", 5) == 0)
+            sscanf(argv[i], "rate:%lf", &options.rate);
+        else if (strncmp(argv[i], "restartDelay:", 13) == 0)
+            sscanf(argv[i], "restartDelay:%ld", &options.restartDelay);
+    }
+}
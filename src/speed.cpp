@@ -10,59 +10,126 @@
 
 
 /**
-    Constructs the multi-layer perceptron with 3
-    layers and 7 input neurons per hidden layer.
+    Constructs the module. The topology of the multi-layer perceptron
+    (3 layers and 7 input neurons per hidden layer) is given by its type.
+    Parameters include the MLP weights and the two bounds on speed values.
 */
-TargetSpeedModule::TargetSpeedModule() {
-    this->mlp = new MLP(7);
-    this->mlp->addFullyConnectedLayer(7, 7);
-    this->mlp->addActivation(ACTIVATION_TANH);
-    this->mlp->addFullyConnectedLayer(7, 7);
-    this->mlp->addActivation(ACTIVATION_TANH);
-    this->mlp->addFullyConnectedLayer(7, 1);
-    // Ensures that the output is in the range [0, 1]
-    this->mlp->addActivation(ACTIVATION_CLIPPING);
+template <typename T>
+TargetSpeedModule<T>::TargetSpeedModule() {
+    this->mlp.bind(this->storage.data());
+}
+
+/**
+    Makes the module read its parameters from the given buffer. The
+    network reads its weights from the same buffer, without copies.
+
+    @param data First of the getNumberOfParameters() values.
+*/
+template <typename T>
+void TargetSpeedModule<T>::bind(T* data) {
+    tModule::bind(data);
+    this->mlp.bind(data);
 }
 
 /**
     Outputs the desired speed based on sensory data.
 
     @param cs Current car state.
+    @param features Features of the current car state.
     @return Desired speed.
 */
-double TargetSpeedModule::control(CarState &cs) {
-    // Normalize sensor data and pass them to the network
+template <typename T>
+T TargetSpeedModule<T>::control(CarState &cs, const CarFeatures<T> &features) {
+    // Pass the normalized sensor data to the network
     for (int i = -3; i < 4; i++) {
-        this->mlp->in(i + 3) = cs.track[FRONT + i] / 200.0;
+        this->mlp.in(i + 3) = features.track[FRONT + i];
     }
 
     // Forward pass
-    this->mlp->forward();
+    this->mlp.forward();
 
     // Retrieve the output value and map it to actual speed
-    double output = this->mlp->out(0);
-    double speed = output * (this->max_speed - this->min_speed) + this->min_speed;
-    if (cs.track[FRONT] >= 100) speed = 300.0;
+    T output = this->mlp.out(0);
+    T min_speed = this->parameters[MIN_SPEED];
+    T max_speed = this->parameters[MAX_SPEED];
+    T speed = output * (max_speed - min_speed) + min_speed;
+    if (cs.track[FRONT] >= 100) speed = 300;
     return speed;
 }
 
 /**
-    Number of module parameters. Parameters include
-    MLP weights and the two bounds on speed values.
+    Normalizes the sensor data of a batch of car states, as in control.
 
-    @return Number of module parameters.
+    @param states Car states.
+    @param n Number of car states.
+    @return Network inputs, one car state per column.
 */
-size_t TargetSpeedModule::getNumberOfParameters() {
-    int n = this->mlp->getNumberOfParameters();
-    return n + 2;
+template <typename T>
+typename TargetSpeedModule<T>::tNetwork::tInputBatch TargetSpeedModule<T>::inputs(const CarState* states, size_t n) {
+    typename tNetwork::tInputBatch X(tNetwork::N_INPUTS, n);
+    for (size_t j = 0; j < n; j++) {
+        for (int i = -3; i < 4; i++) {
+            X(i + 3, j) = states[j].track[FRONT + i] / CarFeatures<T>::TRACK_RANGE;
+        }
+    }
+    return X;
+}
+
+/**
+    Outputs the desired speeds for a batch of car states, e.g. the
+    states of a flight log. The network is evaluated with one matrix
+    product per layer for the whole batch.
+
+    @param states Car states.
+    @param n Number of car states.
+    @param speeds Desired speeds, one per car state (resized).
+*/
+template <typename T>
+void TargetSpeedModule<T>::controlBatch(const CarState* states, size_t n, tSpeeds &speeds) {
+    typename tNetwork::tOutputBatch Y;
+    this->mlp.forwardBatch(this->inputs(states, n), Y);
+    T min_speed = this->parameters[MIN_SPEED];
+    T max_speed = this->parameters[MAX_SPEED];
+    speeds.resize(n);
+    for (size_t j = 0; j < n; j++) {
+        speeds[j] = Y(0, j) * (max_speed - min_speed) + min_speed;
+        if (states[j].track[FRONT] >= 100) speeds[j] = 300;
+    }
+}
+
+/**
+    Outputs the desired speeds for a batch of car states, for several
+    sets of module parameters at once, e.g. for all the particles of
+    a swarm. The current parameters of the module are left unchanged.
+
+    @param states Car states.
+    @param n Number of car states.
+    @param parameters Sets of module parameters, one per column,
+        in the order of getParameters.
+    @param speeds Desired speeds (resized): one row per parameter
+        set, and one column per car state.
+*/
+template <typename T>
+void TargetSpeedModule<T>::controlBatch(const CarState* states, size_t n, const tMatrix &parameters, tMatrix &speeds) {
+    assert(static_cast<size_t>(parameters.rows()) == this->getNumberOfParameters());
+    tNetwork::forwardStacked(parameters, this->inputs(states, n), speeds);
+    for (Eigen::Index k = 0; k < parameters.cols(); k++) {
+        T min_speed = parameters(MIN_SPEED, k);
+        T max_speed = parameters(MAX_SPEED, k);
+        speeds.row(k) = speeds.row(k).array() * (max_speed - min_speed) + min_speed;
+    }
+    for (size_t j = 0; j < n; j++) {
+        if (states[j].track[FRONT] >= 100) speeds.col(j).setConstant(300);
+    }
 }
 
 /**
     @return Lower bounds on the module parameters.
 */
-Eigen::VectorXd TargetSpeedModule::getLowerBounds() {
-    int n = this->mlp->getNumberOfParameters();
-    Eigen::VectorXd lbs = Eigen::VectorXd::Zero(n + 2);
+template <typename T>
+typename TargetSpeedModule<T>::tVector TargetSpeedModule<T>::getLowerBounds() {
+    int n = this->mlp.getNumberOfParameters();
+    tVector lbs = tVector::Zero();
     for (int i = 0; i < n; i++) {
         // lb chosen such that the corresponding uniform
         // distribution has the same standard deviation
@@ -80,9 +147,10 @@ Eigen::VectorXd TargetSpeedModule::getLowerBounds() {
 /**
     @return Upper bounds on the module parameters.
 */
-Eigen::VectorXd TargetSpeedModule::getUpperBounds() {
-    int n = this->mlp->getNumberOfParameters();
-    Eigen::VectorXd ubs = Eigen::VectorXd::Zero(n + 2);
+template <typename T>
+typename TargetSpeedModule<T>::tVector TargetSpeedModule<T>::getUpperBounds() {
+    int n = this->mlp.getNumberOfParameters();
+    tVector ubs = tVector::Zero();
     for (int i = 0; i < n; i++) {
         // lb chosen such that the corresponding uniform
         // distribution has the same standard deviation
@@ -97,33 +165,6 @@ Eigen::VectorXd TargetSpeedModule::getUpperBounds() {
     return ubs;
 }
 
-/**
-    Gets current values of module parameters.
-
-    @return Current values of module parameters.
-*/
-Eigen::VectorXd TargetSpeedModule::getParameters() {
-    int n = this->mlp->getNumberOfParameters();
-    Eigen::VectorXd parameters = Eigen::VectorXd::Zero(n + 2);
-    Eigen::VectorXd weights = this->mlp->getWeights();
-    for (int i = 0; i < n; i++) {
-        parameters[i] = weights[i];
-    }
-    parameters[n] = this->min_speed;
-    parameters[n + 1] = this->max_speed;
-    return parameters;
-}
-
-/**
-    Sets current values of module parameters.
 
-    @param Current values of module parameters.
-*/
-void TargetSpeedModule::setParameters(Eigen::VectorXd parameters) {
-    int n = this->mlp->getNumberOfParameters();
-    Eigen::VectorXd weights = Eigen::VectorXd::Zero(n);
-    for (int i = 0; i < n; i++) weights[i] = parameters[i];
-    this->mlp->setWeights(weights);
-    this->min_speed = parameters[n];
-    this->max_speed = parameters[n + 1];
-}
+template class TargetSpeedModule<float>;
+template class TargetSpeedModule<double>;
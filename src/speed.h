@@ -10,36 +10,65 @@
 #define SPEED_H__
 
 #include "carstate.h"
-#include "mlp.h"
+#include "carfeatures.h"
+#include "fixedmlp.h"
 #include "module.h"
 
 
-class TargetSpeedModule : Module {
+// Multi-layer perceptron of the target speed module: 7 inputs, two hidden
+// layers of 7 neurons, and an output clipped to the range [0, 1]
+template <typename T>
+using tTargetSpeedNetwork = FixedMLP<Dense<7, 7, Tanh, T>, Dense<7, 7, Tanh, T>, Dense<7, 1, Clipping, T>>;
+
+
+template <typename T>
+class TargetSpeedModule : public Module<TargetSpeedModule<T>, T, tTargetSpeedNetwork<T>::N_PARAMETERS + 2> {
 private:
     // Index of the front sensor
     static constexpr int FRONT = 9;
 
     // Multi-layer perceptron
-    MLP* mlp;
+    typedef tTargetSpeedNetwork<T> tNetwork;
+    tNetwork mlp;
 
-    // Minimum and maximum desired speed
-    double min_speed;
-    double max_speed;
+    // Offsets of the minimum and maximum desired speed in the
+    // parameters, which follow the network weights
+    static constexpr int MIN_SPEED = tNetwork::N_PARAMETERS;
+    static constexpr int MAX_SPEED = tNetwork::N_PARAMETERS + 1;
+
+    // Network inputs for a batch of car states
+    typename tNetwork::tInputBatch inputs(const CarState* states, size_t n);
 
 public:
+    // Base class and parameter vectors, speeds of a batch of car states,
+    // and sets of parameters (one per column)
+    typedef Module<TargetSpeedModule<T>, T, tTargetSpeedNetwork<T>::N_PARAMETERS + 2> tModule;
+    typedef typename tModule::tVector tVector;
+    typedef Eigen::Matrix<T, Eigen::Dynamic, 1> tSpeeds;
+    typedef Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> tMatrix;
+    static_assert(MAX_SPEED + 1 == tModule::N_PARAMETERS, "Parameter layout does not match the module size");
+
+    // Sensors read by the module
+    static constexpr unsigned int SENSORS = sensorMask("track");
+
     // Constructor and destructor
     TargetSpeedModule();
     ~TargetSpeedModule() {};
 
+    // Reads the parameters, network weights included, from a buffer
+    void bind(T* data);
+
     // Outputs the desired speed
-    double control(CarState &cs);
-
-    // Abstract method
-    virtual size_t getNumberOfParameters();
-    virtual Eigen::VectorXd getLowerBounds();
-    virtual Eigen::VectorXd getUpperBounds();
-    virtual Eigen::VectorXd getParameters();
-    virtual void setParameters(Eigen::VectorXd parameters);
+    T control(CarState &cs, const CarFeatures<T> &features);
+
+    // Desired speeds for a batch of car states, with the current
+    // parameters or with several parameter sets (offline evaluation)
+    void controlBatch(const CarState* states, size_t n, tSpeeds &speeds);
+    void controlBatch(const CarState* states, size_t n, const tMatrix &parameters, tMatrix &speeds);
+
+    // Bounds on the parameters
+    tVector getLowerBounds();
+    tVector getUpperBounds();
 };
 
 
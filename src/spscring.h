@@ -0,0 +1,98 @@
+/**
+    spscring.h
+    Lock-free single-producer/single-consumer ring
+
+    @author Antoine Passemiers
+    @version 1.0 13/08/2019
+*/
+
+#ifndef SPSCRING_H__
+#define SPSCRING_H__
+
+#include <atomic>
+#include <cstddef>
+
+
+/**
+    Bounded ring shared by exactly one producer thread and one consumer
+    thread. Slots are filled and read in place: the producer claims a
+    slot, fills it and publishes it; the consumer reads the front slot
+    and pops it. Each side keeps a cached copy of the other side's
+    index, so that the shared indices are only read when the cached
+    one says the ring is full (or empty).
+
+    @param T Slot type.
+    @param N Number of slots (power of 2).
+*/
+template <typename T, size_t N>
+class SpscRing {
+    static_assert((N > 0) && ((N & (N - 1)) == 0), "The number of slots must be a power of 2");
+
+private:
+    // Producer side: next slot to publish, and last known consumer position
+    alignas(64) std::atomic<size_t> head{0};
+    size_t tail_cache = 0;
+
+    // Consumer side: next slot to read, and last known producer position
+    alignas(64) std::atomic<size_t> tail{0};
+    size_t head_cache = 0;
+
+    alignas(64) T slots[N];
+
+public:
+
+    /**
+        Producer: gets the next free slot, without publishing it.
+
+        @return Slot to be filled, or nullptr if the ring is full.
+    */
+    T* claim() {
+        size_t h = this->head.load(std::memory_order_relaxed);
+        if (h - this->tail_cache == N) {
+            this->tail_cache = this->tail.load(std::memory_order_acquire);
+            if (h - this->tail_cache == N) return nullptr;
+        }
+        return &this->slots[h & (N - 1)];
+    }
+
+    /**
+        Producer: makes the claimed slot visible to the consumer.
+    */
+    void publish() {
+        this->head.store(this->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+        Consumer: gets the oldest published slot, without popping it.
+
+        @return Slot to be read, or nullptr if the ring is empty.
+    */
+    T* front() {
+        size_t t = this->tail.load(std::memory_order_relaxed);
+        if (t == this->head_cache) {
+            this->head_cache = this->head.load(std::memory_order_acquire);
+            if (t == this->head_cache) return nullptr;
+        }
+        return &this->slots[t & (N - 1)];
+    }
+
+    /**
+        Consumer: releases the front slot to the producer.
+    */
+    void pop() {
+        this->tail.store(this->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+        Whether all the published slots have been popped
+        (can be called from either side).
+
+        @return Whether the ring is empty.
+    */
+    bool empty() const {
+        return this->tail.load(std::memory_order_acquire) == this->head.load(std::memory_order_acquire);
+    }
+};
+
+
+#endif // SPSCRING_H__
@@ -12,9 +12,9 @@
 /**
     Constructs the steering control module.
 */
-SteeringControlModule::SteeringControlModule() {
-    // Allocate space for parameters
-    this->weights = Eigen::VectorXd::Zero(9);
+template <typename T>
+SteeringControlModule<T>::SteeringControlModule() {
+    // Parameters are the weights of the 9 front sensors
 }
 
 /**
@@ -22,58 +22,43 @@ SteeringControlModule::SteeringControlModule() {
     car state.
 
     @param cs Current car state.
+    @param features Features of the current car state.
     @return Steering value.
 */
-double SteeringControlModule::control(CarState &cs) {
-    double steer;
+template <typename T>
+T SteeringControlModule<T>::control(CarState &cs, const CarFeatures<T> &features) {
+    T steer;
     if (cs.gear == -1) {
         // Reversed movement
         steer = -cs.angle / STEER_LOCK;
-    } else if (this->isOnTrack(cs)) { // car is no track
-        double front = cs.track[FRONT];
+    } else if (!features.on_track) {
+        // Note that the sensor-based steering applies out of the track
+        // borders (|trackPos| > 1), and the steering towards the middle
+        // line between them
+        T front = cs.track[FRONT];
 
         // Reduce steering if straight line
-        double f0 = (front >= 100.0) ? 0.2 : 1.0;
+        T f0 = (front >= 100) ? T(0.2) : T(1);
 
-        // Compute steering value
-        double norm = 0.0;
-        steer = 0.0;
+        // Compute steering value, normalized by the sum of the sensors
+        steer = 0;
         for (int i = -4; i < 5; i++) {
-            steer += (cs.track[FRONT + i] * this->weights[i + 4]);
-            norm += cs.track[FRONT + i];
+            steer += (cs.track[FRONT + i] * this->parameters[i + 4]);
         }
-        steer *= (f0 / norm);
+        steer *= (f0 / features.front_track_sum);
     } else {
-        // Car is out of track
-        steer = (cs.angle - cs.trackPos * 0.5) / STEER_LOCK;
+        // Steer towards the middle line
+        steer = (cs.angle - cs.trackPos * T(0.5)) / STEER_LOCK;
     }
     return steer;
 }
 
-/**
-    Checs whether the car is on track.
-
-    @param cs Current car state.
-    @return Whether the car is on track.
-*/
-bool SteeringControlModule::isOnTrack(CarState &cs) {
-    return (std::abs(cs.trackPos) > 1);
-}
-
-/**
-    Number of module parameters (sensor weights).
-
-    @param Number of module parameters.
-*/
-size_t SteeringControlModule::getNumberOfParameters() {
-    return 9;
-}
-
 /**
     @return Lower bounds on the module parameters.
 */
-Eigen::VectorXd SteeringControlModule::getLowerBounds() {
-    Eigen::VectorXd lbs = Eigen::VectorXd::Zero(9);
+template <typename T>
+typename SteeringControlModule<T>::tVector SteeringControlModule<T>::getLowerBounds() {
+    tVector lbs = tVector::Zero();
     for (int i = -4; i < 5; i++) {
         lbs[i + 4] = (i * 0.5) - 0.5;
     }
@@ -83,28 +68,15 @@ Eigen::VectorXd SteeringControlModule::getLowerBounds() {
 /**
     @return Upper bounds on the module parameters.
 */
-Eigen::VectorXd SteeringControlModule::getUpperBounds() {
-    Eigen::VectorXd ubs = Eigen::VectorXd::Zero(9);
+template <typename T>
+typename SteeringControlModule<T>::tVector SteeringControlModule<T>::getUpperBounds() {
+    tVector ubs = tVector::Zero();
     for (int i = -4; i < 5; i++) {
         ubs[i + 4] = (i * 0.5) + 0.5;
     }
     return ubs;
 }
 
-/**
-    Gets current values of module parameters.
-
-    @return Current values of module parameters.
-*/
-Eigen::VectorXd SteeringControlModule::getParameters() {
-    return this->weights;
-}
 
-/**
-    Sets current values of module parameters.
-
-    @param Current values of module parameters.
-*/
-void SteeringControlModule::setParameters(Eigen::VectorXd parameters) {
-    this->weights = parameters;
-}
+template class SteeringControlModule<float>;
+template class SteeringControlModule<double>;
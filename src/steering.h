@@ -13,37 +13,38 @@
 
 #include "carcontrol.h"
 #include "carstate.h"
+#include "carfeatures.h"
 #include "module.h"
 
 
-class SteeringControlModule : Module {
+template <typename T>
+class SteeringControlModule : public Module<SteeringControlModule<T>, T, 9> {
 private:
     // Steer lock
-    static constexpr double STEER_LOCK = 0.785398;
+    static constexpr T STEER_LOCK = 0.785398;
 
     // Index of the front sensor
     static constexpr int FRONT = 9;
 
-    // Sensor weights
-    Eigen::VectorXd weights;
-
 public:
+    // Base class and parameter vectors
+    typedef Module<SteeringControlModule<T>, T, 9> tModule;
+    typedef typename tModule::tVector tVector;
+
+    // Sensors read by the module
+    static constexpr unsigned int SENSORS = sensorMask("angle") | sensorMask("gear")
+        | sensorMask("track") | sensorMask("trackPos");
+
     // Constructor and destructor
     SteeringControlModule();
     ~SteeringControlModule() = default;
 
     // Outputs the steering value based on current car state
-    double control(CarState &cs);
-
-    // Checks whether the car is on track
-    bool isOnTrack(CarState &cs);
+    T control(CarState &cs, const CarFeatures<T> &features);
 
-    // Abstract methods
-    virtual size_t getNumberOfParameters();
-    virtual Eigen::VectorXd getLowerBounds();
-    virtual Eigen::VectorXd getUpperBounds();
-    virtual Eigen::VectorXd getParameters();
-    virtual void setParameters(Eigen::VectorXd parameters);
+    // Bounds on the parameters
+    tVector getLowerBounds();
+    tVector getUpperBounds();
 };
 
 
@@ -0,0 +1,436 @@
+/**
+    transport.cpp
+    Message transports between the client and the server
+
+    @author Antoine Passemiers
+    @version 1.0 12/08/2019
+*/
+
+#ifdef WIN32
+#include <WinSock.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <climits>
+#include <ctime>
+#endif
+
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+#include "latency.h"
+#include "transport.h"
+
+#ifdef WIN32
+typedef int socklen_t;
+#define CLOSE(x) closesocket(x)
+#define INVALID(x) x == INVALID_SOCKET
+#else
+typedef int SOCKET;
+#define CLOSE(x) close(x)
+#define INVALID(x) x < 0
+#endif
+
+
+/**
+    Transport over a datagram socket. Arrival times are the kernel
+    receive timestamps when available (SO_TIMESTAMPNS), otherwise
+    the time at which the message is read.
+*/
+class SocketTransport : public Transport {
+protected:
+    SOCKET fd;
+
+    // Whether this is the server end
+    bool server = false;
+
+    // Peer to which messages are sent (the server for a client,
+    // the sender of the last message for a server)
+    struct sockaddr_storage peer;
+    socklen_t peer_length = 0;
+
+    // Offset from the wall clock of kernel timestamps to the monotonic clock
+    int64_t clock_offset = 0;
+
+    // Asks the kernel to timestamp incoming messages
+    void enableTimestamps() {
+#if !defined(WIN32) && defined(SO_TIMESTAMPNS)
+        int enable = 1;
+        if (setsockopt(this->fd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) < 0)
+            std::cerr << "kernel receive timestamps not available" << std::endl;
+#endif
+        this->synchronizeClocks();
+    }
+
+public:
+    SocketTransport() {
+        this->fd = (SOCKET) -1;
+        std::memset(&this->peer, 0, sizeof(this->peer));
+    }
+
+    virtual ~SocketTransport() {
+        if (!(INVALID(this->fd))) CLOSE(this->fd);
+    }
+
+    virtual bool send(const char* message, size_t length) {
+        if (this->peer_length == 0) return false; // No peer yet
+        return sendto(this->fd, message, length, 0, (struct sockaddr *) &this->peer, this->peer_length) >= 0;
+    }
+
+    virtual int receive(char* buffer, size_t size, long timeout, int64_t &rxTime) {
+        fd_set readSet;
+        struct timeval timeVal;
+        FD_ZERO(&readSet);
+        FD_SET(this->fd, &readSet);
+        timeVal.tv_sec = timeout / 1000000;
+        timeVal.tv_usec = timeout % 1000000;
+        int ready = select(this->fd + 1, &readSet, NULL, NULL, &timeVal);
+        if (ready <= 0) return ready;
+
+        struct sockaddr_storage from;
+        socklen_t from_length = sizeof(from);
+#ifdef WIN32
+        int numRead = recvfrom(this->fd, buffer, size - 1, 0, (struct sockaddr *) &from, &from_length);
+        if (numRead < 0) return -1;
+        rxTime = monotonicNanoseconds();
+#else
+        struct iovec iov;
+        struct msghdr msg;
+        char control[64];
+        iov.iov_base = buffer;
+        iov.iov_len = size - 1;
+        std::memset(&msg, 0, sizeof(msg));
+        msg.msg_name = &from;
+        msg.msg_namelen = from_length;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        int numRead = recvmsg(this->fd, &msg, 0);
+        if (numRead < 0) return -1;
+        from_length = msg.msg_namelen;
+        rxTime = monotonicNanoseconds();
+#ifdef SO_TIMESTAMPNS
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_TIMESTAMPNS)) {
+                struct timespec ts;
+                std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                rxTime = (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec - this->clock_offset;
+            }
+        }
+#endif
+#endif
+        buffer[numRead] = '\0';
+
+        // A server answers whoever talked last
+        if (this->server) {
+            std::memcpy(&this->peer, &from, from_length);
+            this->peer_length = from_length;
+        }
+        return numRead;
+    }
+
+    virtual void synchronizeClocks() {
+        this->clock_offset = realtimeNanoseconds() - monotonicNanoseconds();
+    }
+};
+
+
+/**
+    IPv4 UDP socket: the transport of the SCR server.
+*/
+class UdpTransport : public SocketTransport {
+private:
+    std::string host;
+    unsigned int port;
+
+public:
+    bool open(const char* host, unsigned int port, bool server) {
+        this->host = host;
+        this->port = port;
+        this->server = server;
+        this->fd = socket(AF_INET, SOCK_DGRAM, 0);
+        if (INVALID(this->fd)) {
+            std::cerr << "cannot create socket" << std::endl;
+            return false;
+        }
+
+        struct sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        if (server) {
+            address.sin_addr.s_addr = htonl(INADDR_ANY);
+            if (bind(this->fd, (struct sockaddr *) &address, sizeof(address)) < 0) {
+                std::cerr << "cannot bind port " << port << std::endl;
+                return false;
+            }
+        } else {
+            struct hostent *hostInfo = gethostbyname(host);
+            if (hostInfo == NULL) {
+                std::cerr << "Error: problem interpreting host: " << host << std::endl;
+                return false;
+            }
+            std::memcpy((char *) &address.sin_addr.s_addr, hostInfo->h_addr_list[0], hostInfo->h_length);
+            std::memcpy(&this->peer, &address, sizeof(address));
+            this->peer_length = sizeof(address);
+        }
+        this->enableTimestamps();
+        return true;
+    }
+
+    virtual std::string name() {
+        return "udp " + this->host + ":" + std::to_string(this->port);
+    }
+};
+
+
+#ifndef WIN32
+/**
+    Unix datagram socket, for a client and a server on the same host.
+    The server is bound to the given path, the client to the same
+    path suffixed by its process id.
+*/
+class UnixTransport : public SocketTransport {
+private:
+    // Path to which this end is bound
+    std::string path;
+
+    // Path of the server socket
+    std::string server_path;
+
+    static bool makeAddress(const std::string &path, struct sockaddr_un &address) {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) return false;
+        std::strcpy(address.sun_path, path.c_str());
+        return true;
+    }
+
+public:
+    virtual ~UnixTransport() {
+        if (!this->path.empty()) unlink(this->path.c_str());
+    }
+
+    bool open(const std::string &path, bool server) {
+        this->server = server;
+        this->server_path = path;
+        this->fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if (this->fd < 0) {
+            std::cerr << "cannot create socket" << std::endl;
+            return false;
+        }
+
+        // Each end is bound, so that the other one can answer
+        std::string local = server ? path : path + "." + std::to_string(getpid());
+        struct sockaddr_un address;
+        if (!makeAddress(local, address)) {
+            std::cerr << "socket path too long: " << local << std::endl;
+            return false;
+        }
+        unlink(local.c_str());
+        if (bind(this->fd, (struct sockaddr *) &address, sizeof(address)) < 0) {
+            std::cerr << "cannot bind " << local << std::endl;
+            return false;
+        }
+        this->path = local;
+
+        if (!server) {
+            makeAddress(path, address);
+            std::memcpy(&this->peer, &address, sizeof(address));
+            this->peer_length = sizeof(address);
+        }
+        this->enableTimestamps();
+        return true;
+    }
+
+    virtual std::string name() {
+        return "unix " + this->server_path;
+    }
+};
+#endif
+
+
+#ifdef __linux__
+// Number of slots in a shared-memory ring (power of 2)
+#define SHM_RING_SLOTS 64
+
+// Number of polls of an empty ring before sleeping on the futex
+#define SHM_SPIN 2000
+
+// Message slot of a shared-memory ring
+struct ShmSlot {
+    int64_t timestamp;
+    uint32_t length;
+    char data[TRANSPORT_MSGLEN];
+};
+
+// Single-producer/single-consumer ring of messages. Counters only
+// grow; the consumer sleeps on the head counter when the ring is empty.
+struct ShmRing {
+    alignas(64) std::atomic<uint32_t> head;
+    alignas(64) std::atomic<uint32_t> tail;
+    alignas(64) std::atomic<uint32_t> waiting;
+    ShmSlot slots[SHM_RING_SLOTS];
+};
+
+// Shared segment: one ring per direction
+struct ShmSegment {
+    ShmRing to_server;
+    ShmRing to_client;
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Futexes are 32-bit words");
+
+
+/**
+    Shared-memory rings, for a client and a server on the same host.
+    Each direction is a single-producer/single-consumer ring; a reader
+    with nothing to read spins briefly, then sleeps on a futex that the
+    writer wakes up. A message that does not fit in a full ring is lost,
+    as a datagram would be. Arrival times are the times at which the
+    messages were published.
+*/
+class ShmTransport : public Transport {
+private:
+    std::string name_;
+    bool server = false;
+    ShmSegment* segment = nullptr;
+    ShmRing* in = nullptr;
+    ShmRing* out = nullptr;
+
+    static long futex(std::atomic<uint32_t>* word, int op, uint32_t value, const struct timespec* timeout) {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), op, value, timeout, NULL, 0);
+    }
+
+public:
+    virtual ~ShmTransport() {
+        if (this->segment != nullptr) munmap(this->segment, sizeof(ShmSegment));
+        if (this->server) shm_unlink(this->name_.c_str());
+    }
+
+    bool open(const std::string &name, bool server) {
+        this->name_ = (name[0] == '/') ? name : "/" + name;
+        this->server = server;
+
+        // Whichever end comes first creates the segment (zeroed, hence empty rings)
+        int fd = shm_open(this->name_.c_str(), O_RDWR | O_CREAT, 0600);
+        if (fd < 0) {
+            std::cerr << "cannot open shared memory " << this->name_ << std::endl;
+            return false;
+        }
+        if (ftruncate(fd, sizeof(ShmSegment)) < 0) {
+            std::cerr << "cannot size shared memory " << this->name_ << std::endl;
+            close(fd);
+            return false;
+        }
+        void* ptr = mmap(nullptr, sizeof(ShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (ptr == MAP_FAILED) {
+            std::cerr << "cannot map shared memory " << this->name_ << std::endl;
+            return false;
+        }
+        this->segment = static_cast<ShmSegment*>(ptr);
+        this->in = server ? &this->segment->to_server : &this->segment->to_client;
+        this->out = server ? &this->segment->to_client : &this->segment->to_server;
+        return true;
+    }
+
+    virtual bool send(const char* message, size_t length) {
+        ShmRing* ring = this->out;
+        uint32_t head = ring->head.load(std::memory_order_relaxed);
+        if (head - ring->tail.load(std::memory_order_acquire) == SHM_RING_SLOTS) return true; // Lost
+        if (length > TRANSPORT_MSGLEN) return false;
+
+        ShmSlot &slot = ring->slots[head % SHM_RING_SLOTS];
+        std::memcpy(slot.data, message, length);
+        slot.length = length;
+        slot.timestamp = monotonicNanoseconds();
+        ring->head.store(head + 1, std::memory_order_seq_cst);
+
+        // The consumer announces that it sleeps before checking the ring one last time
+        if (ring->waiting.load(std::memory_order_seq_cst) != 0)
+            futex(&ring->head, FUTEX_WAKE, 1, NULL);
+        return true;
+    }
+
+    virtual int receive(char* buffer, size_t size, long timeout, int64_t &rxTime) {
+        ShmRing* ring = this->in;
+        uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint32_t head = ring->head.load(std::memory_order_acquire);
+
+        if ((head == tail) && (timeout > 0)) {
+            for (int i = 0; (i < SHM_SPIN) && (head == tail); i++)
+                head = ring->head.load(std::memory_order_acquire);
+
+            int64_t deadline = monotonicNanoseconds() + (int64_t) timeout * 1000;
+            while (head == tail) {
+                int64_t remaining = deadline - monotonicNanoseconds();
+                if (remaining <= 0) return 0;
+                struct timespec ts;
+                ts.tv_sec = remaining / 1000000000;
+                ts.tv_nsec = remaining % 1000000000;
+                ring->waiting.store(1, std::memory_order_seq_cst);
+                if (ring->head.load(std::memory_order_seq_cst) == tail)
+                    futex(&ring->head, FUTEX_WAIT, tail, &ts);
+                ring->waiting.store(0, std::memory_order_relaxed);
+                head = ring->head.load(std::memory_order_acquire);
+            }
+        }
+        if (head == tail) return 0;
+
+        const ShmSlot &slot = ring->slots[tail % SHM_RING_SLOTS];
+        size_t length = (slot.length < size - 1) ? slot.length : size - 1;
+        std::memcpy(buffer, slot.data, length);
+        buffer[length] = '\0';
+        rxTime = slot.timestamp;
+        ring->tail.store(tail + 1, std::memory_order_release);
+        return length;
+    }
+
+    virtual std::string name() {
+        return "shm " + this->name_;
+    }
+};
+#endif
+
+
+Transport* openTransport(const std::string &spec, const char* host, unsigned int port, bool server) {
+    if (spec == "udp") {
+        UdpTransport* transport = new UdpTransport();
+        if (transport->open(host, port, server)) return transport;
+        delete transport;
+        return nullptr;
+    }
+#ifndef WIN32
+    if (spec.compare(0, 5, "unix:") == 0) {
+        UnixTransport* transport = new UnixTransport();
+        if (transport->open(spec.substr(5), server)) return transport;
+        delete transport;
+        return nullptr;
+    }
+#endif
+#ifdef __linux__
+    if (spec.compare(0, 4, "shm:") == 0) {
+        ShmTransport* transport = new ShmTransport();
+        if (transport->open(spec.substr(4), server)) return transport;
+        delete transport;
+        return nullptr;
+    }
+#endif
+    std::cerr << "unknown or unsupported transport: " << spec << std::endl;
+    return nullptr;
+}
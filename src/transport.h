@@ -0,0 +1,79 @@
+/**
+    transport.h
+    Message transports between the client and the server
+
+    @author Antoine Passemiers
+    @version 1.0 12/08/2019
+*/
+
+#ifndef TRANSPORT_H__
+#define TRANSPORT_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+// Maximum size of a message, including the terminating null character
+#define TRANSPORT_MSGLEN 1024
+
+
+/**
+    Datagram-like channel between the client and the server: messages
+    are delivered whole, or lost. A client transport talks to the
+    server it was opened for. A server transport answers the peer that
+    sent the last message it received.
+*/
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    /**
+        Sends a message.
+
+        @param message Message to be sent.
+        @param length Number of bytes to send.
+        @return Whether the message could be sent.
+    */
+    virtual bool send(const char* message, size_t length) = 0;
+
+    /**
+        Waits for a message, and null-terminates it.
+
+        @param buffer Where to store the message.
+        @param size Capacity of the buffer.
+        @param timeout Maximum waiting time in microseconds
+            (0 for only reading a message already there).
+        @param rxTime Arrival time of the message on the monotonic
+            clock, in nanoseconds.
+        @return Number of bytes read, 0 if no message
+            arrived in time, or -1 on error.
+    */
+    virtual int receive(char* buffer, size_t size, long timeout, int64_t &rxTime) = 0;
+
+    /**
+        Refreshes the mapping between the clock used for arrival
+        times and the monotonic clock, if they differ.
+    */
+    virtual void synchronizeClocks() {}
+
+    // Name of the transport, for display
+    virtual std::string name() = 0;
+};
+
+
+/**
+    Opens a transport from its command line specification:
+    "udp" (IPv4 UDP socket on host/port), "unix:<path>" (Unix
+    datagram socket) or "shm:<name>" (shared-memory rings).
+
+    @param spec Transport specification.
+    @param host Server host name (UDP only).
+    @param port Server port (UDP only).
+    @param server Whether to open the server end.
+    @return The transport, or nullptr if it could not be opened.
+*/
+Transport* openTransport(const std::string &spec, const char* host, unsigned int port, bool server);
+
+
+#endif // TRANSPORT_H__
@@ -7,6 +7,7 @@
 */
 
 #include "utils.h"
+#include "activations.h"
 
 
 /**
@@ -86,23 +87,35 @@ int argmax(Eigen::VectorXd &vec) {
 /**
     Inplace tanh function.
 
-    @param X Vector on which to apply the function.
+    @param X Vector on which to apply the function
+        (approximated if built with ACTIVATIONS=approx).
 */
-void inplaceTanh(Eigen::VectorXd &X) {
+template <typename T>
+void inplaceTanh(Eigen::Matrix<T, Eigen::Dynamic, 1> &X) {
+#ifdef __APPROX_ACTIVATIONS__
+    approxTanh(X.data(), X.size());
+#else
     for (int i = 0; i < X.size(); i++) {
         X[i] = std::tanh(X[i]);
     }
+#endif
 }
 
 /**
     Inplace sigmoid function.
 
-    @param X Vector on which to apply the function.
+    @param X Vector on which to apply the function
+        (approximated if built with ACTIVATIONS=approx).
 */
-void inplaceSigmoid(Eigen::VectorXd &X) {
+template <typename T>
+void inplaceSigmoid(Eigen::Matrix<T, Eigen::Dynamic, 1> &X) {
+#ifdef __APPROX_ACTIVATIONS__
+    approxSigmoid(X.data(), X.size());
+#else
     for (int i = 0; i < X.size(); i++) {
-        X[i] = 1.0 / (1.0 + std::exp(-X[i]));
+        X[i] = T(1) / (T(1) + std::exp(-X[i]));
     }
+#endif
 }
 
 /**
@@ -110,9 +123,10 @@ void inplaceSigmoid(Eigen::VectorXd &X) {
 
     @param X Vector on which to apply the function.
 */
-void inplaceReLU(Eigen::VectorXd &X) {
+template <typename T>
+void inplaceReLU(Eigen::Matrix<T, Eigen::Dynamic, 1> &X) {
     for (int i = 0; i < X.size(); i++) {
-        X[i] = std::max(0.0, X[i]);
+        X[i] = std::max(T(0), X[i]);
     }
 }
 
@@ -122,8 +136,19 @@ void inplaceReLU(Eigen::VectorXd &X) {
 
     @param X Vector on which to apply the function.
 */
-void inplaceClipping(Eigen::VectorXd &X) {
+template <typename T>
+void inplaceClipping(Eigen::Matrix<T, Eigen::Dynamic, 1> &X) {
     for (int i = 0; i < X.size(); i++) {
-        X[i] = std::max(0.0, std::min(1.0, X[i] + 0.5));
+        X[i] = std::max(T(0), std::min(T(1), X[i] + T(0.5)));
     }
 }
+
+
+template void inplaceSigmoid<float>(Eigen::VectorXf &X);
+template void inplaceSigmoid<double>(Eigen::VectorXd &X);
+template void inplaceTanh<float>(Eigen::VectorXf &X);
+template void inplaceTanh<double>(Eigen::VectorXd &X);
+template void inplaceReLU<float>(Eigen::VectorXf &X);
+template void inplaceReLU<double>(Eigen::VectorXd &X);
+template void inplaceClipping<float>(Eigen::VectorXf &X);
+template void inplaceClipping<double>(Eigen::VectorXd &X);
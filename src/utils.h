@@ -34,11 +34,11 @@ Eigen::MatrixXd randGaussian(size_t n, size_t m, double mu, double std);
 // Argmax of an Eigen vector
 int argmax(Eigen::VectorXd &vec);
 
-// MLP activation functions
-void inplaceSigmoid(Eigen::VectorXd &X);
-void inplaceTanh(Eigen::VectorXd &X);
-void inplaceReLU(Eigen::VectorXd &X);
-void inplaceClipping(Eigen::VectorXd &X);
+// MLP activation functions (instantiated for float and double)
+template <typename T> void inplaceSigmoid(Eigen::Matrix<T, Eigen::Dynamic, 1> &X);
+template <typename T> void inplaceTanh(Eigen::Matrix<T, Eigen::Dynamic, 1> &X);
+template <typename T> void inplaceReLU(Eigen::Matrix<T, Eigen::Dynamic, 1> &X);
+template <typename T> void inplaceClipping(Eigen::Matrix<T, Eigen::Dynamic, 1> &X);
 
 
 #endif // UTILS_H__